@@ -17,6 +17,13 @@ cxxopts::ParseResult parseCircus(int argc, char *argv[]) {
     // clang-format off
 options.add_options()
 ("load-bib-data", ".bib file or directory containing bib files", cxxopts::value<std::string>(), "<PATH>")
+("shard-per-dataset", "Store each dataset (.bib file) in its own database shard, queries run on all shards in parallel")
+("ingest-workers", "Parse the .bib files in <N> worker processes and merge their databases at the end", cxxopts::value<size_t>(), "<N>")
+("query", "Run a SQL query on the database and exit, the keyword_stats, keyword_year_stats, author_stats and author_year_stats tables expose the keyword and author statistics, keyword_country_stats(<country>), keyword_institution_stats(<institution>) and keyword_venue_stats(<venue>) the keyword statistics of one affiliation or venue", cxxopts::value<std::string>(), "<SQL>")
+("bursts", "Print the keywords with a burst of new papers or citations starting in <YEAR> or after and exit", cxxopts::value<size_t>(), "<YEAR>")
+("synonyms", "Keyword synonyms of the ingest, one group per line separated by commas, the first keyword of a group is the canonical one", cxxopts::value<std::string>(), "<FILE>")
+("expression", "Print the papers, citations and impact factor per year of the papers matching a boolean expression over the keywords and exit, e.g. '\"neural network\" AND (fpga OR asic) NOT survey'", cxxopts::value<std::string>(), "<EXPR>")
+("benchmark", "Time the passes over the keywords of the database and exit")
 ("help", "Show options");
     // clang-format on
 
@@ -13,6 +13,13 @@ struct DBPayload {
   std::vector<std::string> index_terms;
   std::vector<std::string> author_keywords;
   std::vector<std::string> areas;
+  // one string per affiliation, e.g. "Department, University, City, Country"
+  std::vector<std::string> affiliations;
+  // journal or proceedings, see venueName; empty if unknown
+  std::string venue;
+  // (variant, canonical keyword) of the keywords changed by the
+  // canonicalization
+  std::vector<std::pair<std::string, std::string>> keyword_variants;
 
   // Constructor
   DBPayload(const std::string& doi, const std::string& title, const int& year,
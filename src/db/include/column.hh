@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Column of fixed-size values of the keyword store: either owned, or a
+// read-only view of memory kept alive by an owner (e.g. a mapped snapshot).
+// A view is used in place by the const accessors, and copied into an owned
+// vector on the first non-const access.
+template <typename T>
+class Column {
+ public:
+  using iterator = typename std::vector<T>::iterator;
+
+  Column() = default;
+  static Column view(const T* data, size_t size,
+                     std::shared_ptr<const void> owner) {
+    Column column;
+    column._view = data;
+    column._viewSize = size;
+    column._owner = std::move(owner);
+    return column;
+  }
+
+  bool isView() const { return _view != nullptr; }
+  size_t size() const { return isView() ? _viewSize : _owned.size(); }
+  bool empty() const { return size() == 0; }
+  const T* data() const { return isView() ? _view : _owned.data(); }
+  const T& operator[](size_t i) const { return data()[i]; }
+
+  T& operator[](size_t i) { return owned()[i]; }
+  iterator begin() { return owned().begin(); }
+  iterator end() { return owned().end(); }
+  void push_back(const T& value) { owned().push_back(value); }
+  void resize(size_t size, const T& value) { owned().resize(size, value); }
+  iterator erase(iterator pos) { return owned().erase(pos); }
+  iterator erase(iterator first, iterator last) {
+    return owned().erase(first, last);
+  }
+  void swap(std::vector<T>& values) { owned().swap(values); }
+  // Copies a view into an owned vector, e.g. before writing to it from
+  // several threads
+  void detach() { owned(); }
+
+ private:
+  std::vector<T>& owned() {
+    if (isView()) {
+      _owned.assign(_view, _view + _viewSize);
+      _view = nullptr;
+      _viewSize = 0;
+      _owner.reset();
+    }
+    return _owned;
+  }
+
+  std::vector<T> _owned;
+  const T* _view = nullptr;
+  size_t _viewSize = 0;
+  std::shared_ptr<const void> _owner;
+};
@@ -2,42 +2,22 @@
 
 #include <SQLiteCpp/SQLiteCpp.h>
 
+#include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include "keywordBursts.hh"
+#include "keywordCooccurrence.hh"
+#include "keywordStore.hh"
+
 struct DBPayload;
 namespace bibtex {
 struct BibTeXEntry;
 }
-enum KeywordType { SubjectArea, IndexTerm, AuthorKeyword, TitleKeyword };
-inline std::string toString(KeywordType type) {
-  switch (type) {
-    case SubjectArea:
-      return "SubjectArea";
-    case IndexTerm:
-      return "IndexTerm";
-    case AuthorKeyword:
-      return "AuthorKeyword";
-    case TitleKeyword:
-      return "TitleKeyword";
-  }
-  return "Unknown";
-}
-
-struct KeywordQueryResult {
-  std::string _word;
-  std::set<KeywordType> _type;
-  std::map<size_t, size_t> _yearToCitations;
-  double _zScore = 0;
-  size_t _totalCitations = 0;
-  std::unordered_set<std::string> _papers;
-  std::map<size_t, std::unordered_set<std::string>> _yearToPapers;
-  // these are require for the impact factor calculation
-  std::map<size_t, size_t>
-      _yearToCitationInYearOfPapersPublishedThePreviousTwoYears;
-};
 
 extern SQLite::Database db;
 
@@ -45,8 +25,52 @@ void openDB();
 
 void createDB();
 
-// Helper function to insert data into all related tables
-void insertPaper(const DBPayload& payload);
+// Creates the tables holding the papers, used for the main database, the
+// shards and the temporary databases of the ingest workers
+void createTables(SQLite::Database& database);
+
+// Returns the shard of a dataset, creating it and adding it to the catalog of
+// the main database if needed
+SQLite::Database& getShard(const std::string& dataset);
+
+// Opens another connection to the database file at path (the main database
+// or a shard), e.g. for a writer on another thread; the databases are in WAL
+// mode, so the readers and the writer do not block each other
+std::unique_ptr<SQLite::Database> openConnection(const std::string& path);
+
+// Returns the main database followed by all the open shards
+std::vector<SQLite::Database*> getDatabases();
+
+// Name of the dataset (and shard) of a .bib file
+std::string getDatasetName(const std::string& bibFile);
+
+// True if a paper with this doi is stored in any database
+bool paperExists(const std::string& doi);
+bool paperExists(const std::string& doi,
+                 const std::vector<SQLite::Database*>& databases);
+
+// Authors of a BibTeX author list ("Last, F. and Other, G."), trimmed, in
+// order, without "others"
+std::vector<std::string> splitAuthors(const std::string& authorsList);
+// Institution and country of an affiliation ("Department, Institution, City,
+// Country"): the country is the last part, the institution the first part
+// naming one (a university first), otherwise the first part; empty if the
+// affiliation has no country
+std::pair<std::string, std::string> parseAffiliation(
+    const std::string& affiliation);
+// Venue of a paper from its journal field, or its abbreviated source title
+// if it has none, so that the editions of a conference are one venue: the
+// years are dropped, a trailing acronym names the venue ("Proceedings of the
+// 2019 Design, Automation and Test in Europe Conference, DATE 2019" is DATE)
+// and otherwise the "Proceedings" prefix is dropped ("Proceedings - Design
+// Automation Conference" is Design Automation Conference)
+std::string venueName(const std::string& journal,
+                      const std::string& abbrevSourceTitle);
+
+// Helper function to insert data into all related tables, returns false if
+// the paper could not be inserted (nothing is inserted then)
+bool insertPaper(const DBPayload& payload);
+bool insertPaper(const DBPayload& payload, SQLite::Database& database);
 
 std::vector<DBPayload> getPapers(std::string keyword);
 
@@ -67,14 +91,155 @@ void printAreas();
 
 void printAllTables();
 
+// Runs an arbitrary query and prints the result as tab separated values,
+// false if the query failed
+bool printQuery(const std::string& sql);
+
 // Function to convert a BibTeXEntry to a DBPayload
 DBPayload toDBPayload(const bibtex::BibTeXEntry& entry);
 
+// Detailed statistics of all the keywords, sorted by word
 std::vector<KeywordQueryResult> queryAllKeywords();
 
-std::vector<KeywordQueryResult> searchKeywords(const std::string& searchString);
+// Statistics of the keywords of newly inserted papers, of all of them and of
+// the papers of each venue (lower case, as the venue slices)
+struct KeywordDelta {
+  std::vector<KeywordQueryResult> keywords;
+  std::map<std::string, std::vector<KeywordQueryResult>> venueKeywords;
+};
+
+// Statistics of the keywords of newly inserted papers only (without
+// z-scores), computed from their payloads without querying the database: the
+// delta to merge with mergeIntoKeywordStore
+KeywordDelta keywordsOfPapers(const std::vector<DBPayload>& payloads);
+
+// Order of the keyword search results, by one of the summary or trend
+// metrics of KeywordStore
+enum class KeywordOrder {
+  Citations,
+  ZScore,
+  Slope,
+  GrowthRate,
+  Acceleration,
+  Share,
+  ImpactFactor,
+  HIndex,
+  GIndex,
+  MedianCitations,
+  TopDecileCitations
+};
+
+struct KeywordSearchResult {
+  // in the requested order
+  std::vector<KeywordStore::Row> rows;
+  // number of matching keywords, rows holds at most k of them
+  size_t nMatches = 0;
+};
 
-void addZScore(KeywordQueryResult& result);
-KeywordQueryResult getKQR(const std::string& keyword);
-void addKQR(const KeywordQueryResult& kqr);
-void removeKQR(const KeywordQueryResult& kqr);
+// The k first keywords, in the given order, among the keywords matching the
+// regex (all if empty) and having one of the types. The rows are selected
+// with a bounded heap while scanning, so only k of them are kept and sorted.
+// With a year range, the citations, z-score and impact factor orders are the
+// windowed metrics of the range (see KeywordStore::citationsIn), the other
+// orders still cover all the years
+KeywordSearchResult searchKeywords(const std::string& searchString,
+                                   const std::set<KeywordType>& types,
+                                   KeywordOrder order, bool descending,
+                                   size_t k,
+                                   const YearRange& years = YearRange());
+// The same among the keywords of another store, e.g. a slice
+KeywordSearchResult searchKeywords(const KeywordStore& store,
+                                   const std::string& searchString,
+                                   const std::set<KeywordType>& types,
+                                   KeywordOrder order, bool descending,
+                                   size_t k,
+                                   const YearRange& years = YearRange());
+
+// Cached statistics of all the authors, aggregated as the keywords (rows of
+// type Author, with their detail) on first use
+KeywordStore& getAuthorStore();
+// The k first authors, in the given order, among the authors whose name
+// starts with prefix (case insensitive); the names are kept sorted, so only
+// the matching ones are visited
+KeywordSearchResult searchAuthors(const std::string& prefix,
+                                  KeywordOrder order, bool descending,
+                                  size_t k,
+                                  const YearRange& years = YearRange());
+
+// Cached statistics of all the keywords with z-scores, computed on first use.
+// Only the summaries are loaded, see loadKeywordDetail. They are mapped from
+// the snapshot next to the database if it matches its content, otherwise
+// aggregated and saved to it
+KeywordStore& getKeywordStore();
+// Computes the detail of a keyword of the cached store (its papers) if not
+// cached yet
+void loadKeywordDetail(KeywordStore::Row row);
+// Same for all the keywords, in one aggregation
+void loadAllKeywordDetails();
+// Adds the statistics of newly inserted papers (see keywordsOfPapers) to the
+// cached store and to the venue slices, recomputing the z-scores and trends
+// of the touched keywords only
+void mergeIntoKeywordStore(const KeywordDelta& delta);
+// Row of a keyword of the cached store, exits if missing
+KeywordStore::Row getKQR(const std::string& keyword);
+// Keywords of the bib files stored as a canonical keyword (see
+// KeywordCanonicalizer), sorted
+std::vector<std::string> getKeywordVariants(const std::string& keyword);
+// Adds a keyword as the union of other keywords, see KeywordStore::addUnion
+KeywordStore::Row addKQR(const std::string& word,
+                         const std::vector<KeywordStore::Row>& rows);
+// Removes a keyword of the cached store in O(1), the other rows stay valid
+void removeKQR(KeywordStore::Row row);
+// Evaluates a boolean expression over the keywords of the cached store (see
+// KeywordExpression), e.g. "neural network" AND (fpga OR asic) NOT survey,
+// into a store of its own whose row 0 is named by the expression, for the
+// papers matching it (see KeywordStore::paperSetStore): the terms are the
+// keywords as stored or canonicalized, their papers are combined as sets and
+// the citations per year of the result are counted once per paper. The
+// cached store is not changed; false with a warning if the expression is
+// invalid
+bool evaluateKeywordExpression(const std::string& expression,
+                               KeywordStore& result);
+
+// Co-occurrences of the keywords of the cached store, built on first use and
+// updated by mergeIntoKeywordStore
+const KeywordCooccurrence& getKeywordCooccurrence();
+// The n keywords sharing the most papers with a keyword
+std::vector<KeywordCooccurrence::Entry> getRelatedKeywords(
+    KeywordStore::Row row, size_t n);
+// Number of papers shared by two keywords
+size_t countSharedPapers(KeywordStore::Row a, KeywordStore::Row b);
+
+// Bursts of the keywords of the cached store, detected on first use and
+// again once the store changed
+const KeywordBursts& getKeywordBursts();
+// Prints the keywords with a burst of new papers or citations starting in
+// sinceYear or after, most intense first, for --bursts
+void printBurstingKeywords(size_t sinceYear);
+// Prints the papers, citations and impact factor per year of the papers
+// matching a boolean expression over the keywords (see
+// evaluateKeywordExpression), for --expression
+void printKeywordExpression(const std::string& expression);
+// Times the passes over the keywords of the databases (aggregation, snapshot,
+// detail, z-scores, trends, bursts, co-occurrences) and prints them, for
+// --benchmark
+void benchmarkKeywordPasses();
+
+// Dimensions slicing the keyword statistics by the affiliations or the venue
+// of the papers
+enum class SliceDimension { Institution, Country, Venue };
+// Statistics of the keywords of the papers of one institution, country or
+// venue (case insensitive, empty if unknown), with their detail and z-scores.
+// A slice is aggregated on first use from the papers linked to the interned
+// name, a range of the primary key, among the papers counted by the cached
+// store (not those of a pending ingest batch), and cached until new papers
+// are merged.
+// The venues are few and compared with each other, the slices of all of them
+// are aggregated together on first use, and the new papers of a venue are
+// merged into its slice
+const KeywordStore& getKeywordSlice(SliceDimension dimension,
+                                    const std::string& name);
+// Institutions, countries or venues with their number of papers, most papers
+// first
+std::vector<std::pair<std::string, size_t>> getSliceNames(
+    SliceDimension dimension);
@@ -0,0 +1,23 @@
+#pragma once
+
+namespace SQLite {
+class Database;
+}
+
+// Registers the circus analytics functions on a connection:
+//
+// circus_zscore(year, citations [, ref_year])
+//   aggregate, z-score of the citations of ref_year (default: last year)
+//   with respect to the per-year series of the group, same as the keyword z-scores
+//
+// circus_impact_factor(year, pub_year, doi, citation_year, citations)
+//   aggregate, two-year impact factor of the group in the given year; expects
+//   one row per (paper, citation year), e.g. paper LEFT JOIN citations. The
+//   year must be the same non-negative value on all the rows of a group,
+//   otherwise the query fails
+//
+// Example:
+//   SELECT author_keyword, circus_zscore(citations.year, citations.number)
+//   FROM author_keyword_paper JOIN citations USING (doi)
+//   GROUP BY author_keyword;
+void registerCircusFunctions(SQLite::Database& database);
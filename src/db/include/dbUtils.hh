@@ -1,6 +1,9 @@
 #pragma once
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <ctime>
+#include <map>
 #include <numeric>
 #include <sstream>
 #include <string>
@@ -44,12 +47,16 @@ inline double calculateMean(const std::vector<size_t>& values) {
   return sum / values.size();
 }
 
+// two-pass: summing the squared deviations from the mean does not lose the
+// precision that sum(x^2)/n - mean^2 loses on large values
 inline double calculateStandardDeviation(const std::vector<size_t>& values,
                                          double mean) {
-  double sq_sum =
-      std::inner_product(values.begin(), values.end(), values.begin(), 0.0);
-  double variance = sq_sum / values.size() - mean * mean;
-  return std::sqrt(variance);
+  double sq_sum = 0;
+  for (size_t value : values) {
+    double deviation = value - mean;
+    sq_sum += deviation * deviation;
+  }
+  return std::sqrt(sq_sum / values.size());
 }
 
 inline size_t getCurrentYear() {
@@ -58,3 +65,116 @@ inline size_t getCurrentYear() {
   return 1900 + ltm->tm_year;
 }
 
+// z-score of the average of the last two years (refYear, refYear - 1) with
+// respect to the mean and standard deviation of the whole series; years
+// missing from the series count as zero
+inline double computeZScore(const std::map<size_t, size_t>& yearToValue,
+                            size_t refYear) {
+  if (yearToValue.size() < 2) {
+    // Not enough data points to calculate Z-score
+    return 0;
+  }
+
+  std::vector<size_t> values;
+  for (const auto& [year, value] : yearToValue) {
+    values.push_back(value);
+  }
+
+  double mean = calculateMean(values);
+  double stdDev = calculateStandardDeviation(values, mean);
+  if (stdDev == 0) {
+    return 0;  // Avoid division by zero
+  }
+
+  double lastYear =
+      yearToValue.count(refYear) ? yearToValue.at(refYear) : 0;
+  double lastButOneYear =
+      yearToValue.count(refYear - 1) ? yearToValue.at(refYear - 1) : lastYear;
+  return ((lastYear + lastButOneYear) / 2 - mean) / stdDev;
+}
+
+// Same as above on a dense series: values[i] is the value of the year
+// firstYear + i, and all the nYears years belong to the series. Used as the
+// kernel of the batch computation, so it does not allocate; the sum is exact
+// in integers and the loops are contiguous
+inline double computeZScore(const uint32_t* values, size_t firstYear,
+                            size_t nYears, size_t refYear) {
+  if (nYears < 2) {
+    return 0;
+  }
+
+  uint64_t sum = 0;
+  for (size_t i = 0; i < nYears; i++) {
+    sum += values[i];
+  }
+  double mean = static_cast<double>(sum) / nYears;
+  double sq_sum = 0;
+  for (size_t i = 0; i < nYears; i++) {
+    double deviation = values[i] - mean;
+    sq_sum += deviation * deviation;
+  }
+  double stdDev = std::sqrt(sq_sum / nYears);
+  if (stdDev == 0) {
+    return 0;
+  }
+
+  auto valueIn = [&](size_t year, double missing) -> double {
+    return year >= firstYear && year < firstYear + nYears
+               ? values[year - firstYear]
+               : missing;
+  };
+  double lastYear = valueIn(refYear, 0);
+  double lastButOneYear = valueIn(refYear - 1, lastYear);
+  return ((lastYear + lastButOneYear) / 2 - mean) / stdDev;
+}
+
+// Least-squares slope of a dense series against its years, in value per year;
+// 0 below two years. The sums over the year offsets are in closed form, the
+// loop is contiguous and exact in integers
+inline double computeSlope(const uint32_t* values, size_t nYears) {
+  if (nYears < 2) {
+    return 0;
+  }
+  uint64_t sum = 0;
+  uint64_t weighted = 0;
+  for (size_t i = 0; i < nYears; i++) {
+    sum += values[i];
+    weighted += i * values[i];
+  }
+  double n = nYears;
+  double sumOffsets = n * (n - 1) / 2;
+  double sumSquares = (n - 1) * n * (2 * n - 1) / 6;
+  return (n * weighted - sumOffsets * sum) /
+         (n * sumSquares - sumOffsets * sumOffsets);
+}
+
+// Compound annual growth rate of a dense series, from its first nonzero value
+// to its last value: -1 if the last value is zero, 0 without two years
+inline double computeGrowthRate(const uint32_t* values, size_t nYears) {
+  size_t first = 0;
+  while (first < nYears && values[first] == 0) {
+    first++;
+  }
+  if (first + 1 >= nYears) {
+    return 0;
+  }
+  if (values[nYears - 1] == 0) {
+    return -1;
+  }
+  return std::pow(static_cast<double>(values[nYears - 1]) / values[first],
+                  1.0 / (nYears - 1 - first)) -
+         1;
+}
+
+// two-year impact factor: citations received in a year by the papers
+// published in the two previous years, divided by the number of those papers
+inline double computeImpactFactor(size_t citationsOfPreviousTwoYears,
+                                  size_t papersOneYearBefore,
+                                  size_t papersTwoYearsBefore) {
+  if (papersOneYearBefore + papersTwoYearsBefore == 0) {
+    return 0;
+  }
+  return static_cast<double>(citationsOfPreviousTwoYears) /
+         (papersOneYearBefore + papersTwoYearsBefore);
+}
+
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "keywordStore.hh"
+
+// Burst detection over the yearly series of the keywords of a KeywordStore,
+// with the two-state automaton of Kleinberg ("Bursty and Hierarchical
+// Structure in Streams"): in year t a keyword has r[t] of the d[t] events of
+// the corpus (its new papers among all the papers, or its citations among
+// the citations of all the keywords). The base state emits at the rate of
+// the whole series, the burst state at rateRatio times that rate, entering
+// it costs transitionCost * ln(years); the cheapest state sequence (Viterbi)
+// gives the bursts, their intensity is the cost saved by the burst state.
+class KeywordBursts {
+ public:
+  using Row = KeywordStore::Row;
+
+  enum Series : uint8_t { NewPapers, Citations };
+
+  struct Burst {
+    Row row;
+    Series series;
+    // years of the burst, inclusive
+    uint16_t from;
+    uint16_t to;
+    double intensity;
+  };
+
+  static constexpr double rateRatio = 2;
+  static constexpr double transitionCost = 1;
+
+  // Detects the bursts of all the rows in the years of the store up to
+  // refYear, in parallel blocks of rows
+  void compute(const KeywordStore& store, size_t refYear);
+  // Version of the store of the last compute
+  size_t storeVersion() const { return _storeVersion; }
+
+  // All the bursts, by row then series and year
+  const std::vector<Burst>& bursts() const { return _bursts; }
+  // The bursts of a series starting in sinceYear or after, the most intense
+  // of each keyword, most intense first; the removed rows are skipped
+  std::vector<Burst> since(size_t sinceYear, Series series,
+                           const KeywordStore& store) const;
+
+ private:
+  std::vector<Burst> _bursts;
+  size_t _storeVersion = std::numeric_limits<size_t>::max();
+};
+
+inline const char* toString(KeywordBursts::Series series) {
+  return series == KeywordBursts::NewPapers ? "new_papers" : "citations";
+}
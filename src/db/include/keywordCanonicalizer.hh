@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// Maps the variants of a keyword to one canonical keyword, applied at ingest
+// after the lowercase and trim of splitFix:
+// - punctuation folding: hyphens, underscores, slashes and the dots outside
+//   of numbers are spaces ("low-power" is "low power"), quotes are dropped,
+//   a trailing acronym in parentheses is dropped ("field programmable gate
+//   array (fpga)"), the spaces are collapsed
+// - light stemming of each word, plurals only (S-stemmer: "technologies" is
+//   "technology", "networks" is "network", "gpus" is "gpu", "analysis" and
+//   "physics" stay)
+// - synonyms of an optional file, one group per line separated by commas,
+//   the first term is the canonical one; '#' starts a comment
+//
+// The canonical keyword only depends on the variant and the synonyms, so the
+// databases of a parallel ingest or of the shards agree without sharing
+// anything.
+class KeywordCanonicalizer {
+ public:
+  // Reads a synonym file, false if it can not be read
+  bool loadSynonyms(const std::string& path);
+
+  std::string canonical(const std::string& keyword) const;
+
+  // Hash of the rules and the synonyms: the keywords stored under another
+  // signature are canonicalized again
+  uint64_t signature() const { return _signature; }
+
+ private:
+  // folded and stemmed, without the synonyms
+  static std::string normalize(const std::string& keyword);
+
+  // normalized variant -> normalized canonical keyword
+  std::unordered_map<std::string, std::string> _synonyms;
+  uint64_t _signature = rulesVersion;
+
+  // bumped on any change of the folding or stemming rules
+  static constexpr uint64_t rulesVersion = 2;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "keywordStore.hh"
+
+// Sparse keyword x keyword matrix of the number of papers shared by two
+// keywords of a KeywordStore, in compressed sparse rows: the entries of a row
+// are contiguous and sorted by decreasing count, so the keywords most related
+// to a row are a prefix of it.
+//
+// Papers added after the build go to a per-row delta, merged by the queries
+// and folded into the rows once it grows past a fraction of them.
+class KeywordCooccurrence {
+ public:
+  using Row = KeywordStore::Row;
+  using PaperId = KeywordStore::PaperId;
+
+  struct Entry {
+    Row row;
+    // number of shared papers
+    uint32_t count;
+  };
+
+  // Builds the matrix from (paper, keyword) pairs, in any order and possibly
+  // repeated. The rows are split into blocks of about the same work computed
+  // on their own threads
+  void build(std::vector<std::pair<PaperId, Row>> pairs, size_t nRows);
+  bool isBuilt() const { return !_offsets.empty(); }
+  // Counts a new paper with its keywords
+  void addPaper(std::vector<Row> rows);
+
+  // The n keywords sharing the most papers with a row, ties by row; the rows
+  // removed from the store are skipped
+  std::vector<Entry> related(Row row, size_t n,
+                             const KeywordStore& store) const;
+  // Number of papers shared by two keywords
+  uint32_t sharedPapers(Row a, Row b) const;
+
+  // Bytes used by the matrix, for diagnostics
+  size_t memoryUsage() const;
+
+ private:
+  size_t nRows() const { return _offsets.empty() ? 0 : _offsets.size() - 1; }
+  // Entries of a row in the rows and in the delta, sorted
+  std::vector<Entry> merged(Row row) const;
+  // Moves the delta into the rows
+  void fold();
+
+  // entries of row r in [_offsets[r], _offsets[r + 1])
+  std::vector<uint64_t> _offsets;
+  std::vector<Entry> _entries;
+  // counts of the papers added since the build, by row then related row
+  std::unordered_map<Row, std::unordered_map<Row, uint32_t>> _delta;
+  size_t _deltaSize = 0;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "paperSet.hh"
+
+// Boolean expression over the papers of keywords, e.g.
+//   "neural network" AND (fpga OR asic) NOT survey
+// A term is a quoted keyword or a run of words without operator, the
+// operators are the upper case words AND, OR and NOT and the parentheses.
+// "a NOT b" is "a AND NOT b", AND and NOT bind tighter than OR; a leading
+// NOT is the complement in all the papers.
+//
+// The expression is compiled once into a postfix program, evaluated with
+// the set operations of PaperSet on the papers of its terms.
+class KeywordExpression {
+ public:
+  // Compiles an expression, false (and error() set) if it is invalid
+  bool parse(const std::string& expression);
+  const std::string& error() const { return _error; }
+  // True if a text has an operator word, i.e. is meant as an expression
+  // rather than a keyword, even if it is not complete yet
+  static bool hasOperator(const std::string& text);
+
+  // Keywords of the terms, in the order of their papers in evaluate
+  const std::vector<std::string>& terms() const { return _terms; }
+  // Papers matching the expression given the papers of each term; nPapers
+  // bounds the complement of NOT
+  PaperSet evaluate(const std::vector<const PaperSet*>& termPapers,
+                    size_t nPapers) const;
+
+ private:
+  enum Op : uint8_t { Term, And, Or, AndNot, Not };
+  struct Instruction {
+    Op op;
+    uint32_t term;
+  };
+
+  std::vector<Instruction> _program;
+  std::vector<std::string> _terms;
+  std::string _error;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "keywordStore.hh"
+
+// Binary snapshot of the summaries of a KeywordStore, to skip the
+// aggregation on the next start.
+//
+// The file has a header and one section per column, each section aligned to
+// a page. It is mapped read-only and shared, the fixed-size columns of the
+// loaded store are views of the mapping (so several processes share the same
+// physical pages), only the strings are copied. The snapshot is valid for one
+// key, the hash of the content of the databases, and one format version.
+class KeywordSnapshot {
+ public:
+  // Writes the summaries of the store, atomically replacing the file; false
+  // if the store has removed rows
+  static bool save(const KeywordStore& store, const std::string& path,
+                   uint64_t key);
+  // Replaces the content of the store with the snapshot, false (and the
+  // store untouched) if missing, invalid or of another key
+  static bool load(KeywordStore& store, const std::string& path, uint64_t key);
+
+  // FNV-1a, to build keys; seed chains the hash of several strings
+  static uint64_t hash(const std::string& data,
+                       uint64_t seed = 14695981039346656037ull);
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+namespace SQLite {
+class Database;
+}
+
+// Registers eponymous virtual tables exposing the cached keyword
+// statistics (the same data shown in the GUI) to SQL:
+//
+// keyword_stats(word, types, total_citations, z_score, papers, first_year,
+//               last_year, slope, growth_rate, acceleration, share,
+//               impact_factor, h_index, g_index, median_citations,
+//               top_decile_citations)
+//   one row per keyword; equality on word is a hash lookup, ranges and
+//   ORDER BY on total_citations or z_score use a sorted index. The trend
+//   metrics are those of KeywordStore
+//
+// keyword_year_stats(word, year, citations, new_papers, if_citations,
+//                    impact_factor)
+//   one row per keyword and year; equality on word and ranges on year
+//   restrict the scan
+//
+// The cache is warmed on first use if the GUI did not do it already. Both
+// tables read the summary columns of the store, the per-year series
+// included; no keyword detail is loaded.
+//
+// author_stats(name, total_citations, z_score, ..., top_decile_citations)
+// author_year_stats(name, year, citations, new_papers, if_citations,
+//                   impact_factor)
+//   the same for the authors, see getAuthorStore
+//
+// keyword_country_stats(word, types, ..., share, country HIDDEN)
+// keyword_institution_stats(..., institution HIDDEN)
+// keyword_venue_stats(..., venue HIDDEN)
+//   keyword_stats restricted to the papers of one country, institution or
+//   venue, given as argument: SELECT * FROM keyword_country_stats('Germany');
+//   see getKeywordSlice
+void registerKeywordStatsModule(SQLite::Database& database);
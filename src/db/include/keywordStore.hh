@@ -0,0 +1,391 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "column.hh"
+#include "paperSet.hh"
+
+// Author is the type of the rows of the author store, see getAuthorStore
+enum KeywordType {
+  SubjectArea,
+  IndexTerm,
+  AuthorKeyword,
+  TitleKeyword,
+  Author
+};
+inline std::string toString(KeywordType type) {
+  switch (type) {
+    case SubjectArea:
+      return "SubjectArea";
+    case IndexTerm:
+      return "IndexTerm";
+    case AuthorKeyword:
+      return "AuthorKeyword";
+    case TitleKeyword:
+      return "TitleKeyword";
+    case Author:
+      return "Author";
+  }
+  return "Unknown";
+}
+
+// Years [from, to] of the windowed metrics of KeywordStore, both included;
+// the default covers all the years
+struct YearRange {
+  size_t from = 0;
+  size_t to = std::numeric_limits<size_t>::max();
+  bool isAll() const {
+    return from == 0 && to == std::numeric_limits<size_t>::max();
+  }
+};
+
+// Summary of a keyword as aggregated from the database: what the keyword table,
+// the z-score and the impact factor need, without the papers
+struct KeywordSummary {
+  std::string _word;
+  std::set<KeywordType> _type;
+  std::map<size_t, size_t> _yearToCitations;
+  std::map<size_t, size_t> _yearToNewPapers;
+  // citations received in a year by the papers of the two previous years
+  std::map<size_t, size_t> _yearToIFCitations;
+  // total citations of each paper
+  std::vector<uint32_t> _paperCitations;
+  size_t _totalCitations = 0;
+  size_t _nPapers = 0;
+  // publication years of the papers, _firstPaperYear > _lastPaperYear if none
+  size_t _firstPaperYear = std::numeric_limits<size_t>::max();
+  size_t _lastPaperYear = 0;
+};
+
+// Detailed statistics of a keyword as aggregated from the database, with its
+// papers and the impact factor series
+struct KeywordQueryResult {
+  std::string _word;
+  std::set<KeywordType> _type;
+  std::map<size_t, size_t> _yearToCitations;
+  size_t _totalCitations = 0;
+  std::unordered_set<std::string> _papers;
+  std::map<size_t, std::unordered_set<std::string>> _yearToPapers;
+  // these are require for the impact factor calculation
+  std::map<size_t, size_t>
+      _yearToCitationInYearOfPapersPublishedThePreviousTwoYears;
+  // total citations of each paper, for the citation distribution
+  std::unordered_map<std::string, size_t> _paperCitations;
+};
+
+// Columnar store of the keyword statistics, one row per keyword.
+// The per-year metrics are dense keyword x year matrices of uint32_t over the
+// years spanned by the whole store, so the series of a keyword is contiguous.
+// Papers get dense ids, each keyword keeps a compressed set of its papers.
+// The total citations of the papers of each keyword are kept as one
+// contiguous array per keyword, sorted, for the citation distribution.
+//
+// A row has two tiers: the summary (types, citations, new papers and impact
+// factor citations per year, citations of the papers, z-score) is loaded for all the
+// keywords, the detail (the papers) only for the keywords that need it, see
+// hasDetail(). Reading the detail of a row without it returns empty values.
+//
+// Rows are stable handles: a removed row is left as a tombstone, skipped by
+// the scans over [0, size()) with isRemoved(), so removing is O(1) and the
+// other rows keep their number.
+class KeywordStore {
+ public:
+  using Row = uint32_t;
+  using PaperId = PaperSet::Id;
+  static constexpr Row npos = std::numeric_limits<Row>::max();
+
+  // Number of rows, removed ones included
+  size_t size() const { return _words.size(); }
+  bool empty() const { return _words.empty(); }
+  // Number of rows not removed
+  size_t nKeywords() const { return size() - _nRemoved; }
+  bool isRemoved(Row row) const { return _removed[row]; }
+  // Incremented on every change, used to invalidate derived indices
+  size_t version() const { return _version; }
+
+  // Row of a keyword, npos if missing
+  Row find(const std::string& word) const;
+
+  // Adds a keyword, or merges the summary into the existing one (e.g. from
+  // another shard); the z-score is not updated
+  Row add(const KeywordSummary& summary);
+  // Adds a keyword with its detail, or merges the statistics into the existing
+  // one; the z-score is not updated
+  Row add(const KeywordQueryResult& kqr);
+  // Adds the statistics of new papers of the keyword to a row, the detail is
+  // only updated if the row has it
+  void merge(Row row, const KeywordQueryResult& kqr);
+  // Adds a keyword merging the given rows, which must have their detail:
+  // citations are summed, papers appearing in several rows are counted once.
+  // A word already in the store gets a suffix, " (2)", " (3)"...
+  Row addUnion(const std::string& word, const std::vector<Row>& rows);
+  // A store of one keyword, row 0, for a set of known papers, e.g. the
+  // papers matching a KeywordExpression, with the types of the rows of its
+  // terms; this store is not changed. The citations per year (all of them,
+  // and the ones of the impact factor) are computed by the caller on the
+  // same papers, so a paper is counted once. The new store has the years of
+  // this one and its metrics are computed at refYear, the one of the last
+  // computeTrends, its share relative to the keywords of this store; it does
+  // not know the papers
+  KeywordStore paperSetStore(const std::string& word, const PaperSet& papers,
+                             const std::vector<Row>& terms,
+                             const std::map<size_t, size_t>& yearToCitations,
+                             const std::map<size_t, size_t>& yearToIFCitations,
+                             size_t refYear) const;
+  // Sets the detail of a row, computed on the same papers as its summary.
+  // Filling this cache does not change the version
+  void setDetail(Row row, const KeywordQueryResult& kqr);
+  bool hasDetail(Row row) const { return _hasDetail[row]; }
+  // Removes a row: its word is no longer found, the other rows are unchanged
+  void remove(Row row);
+  void clear();
+
+  // z-scores of the citations of refYear, for one row or all of them; the
+  // caller fixes refYear once for a whole run. All the rows are computed in
+  // parallel blocks
+  void computeZScore(Row row, size_t refYear);
+  void computeZScores(size_t refYear);
+  // Trend metrics of the citations per year from the first year of a keyword
+  // to refYear, the impact factor series, the citation distribution and the
+  // prefix sums of the windowed metrics, all the rows in one batched pass (in
+  // parallel blocks, as the z-scores). The share is relative to the
+  // citations of refYear summed over the keywords.
+  // updateTrends computes the rows changed since (e.g. by merge) in
+  // O(changed rows): the sum is adjusted by their change, and their citation
+  // arrays are sorted apart until the next batched pass; a new refYear
+  // falls back to the batched pass. computeTrend updates one row
+  void computeTrend(Row row, size_t refYear);
+  void updateTrends(const std::vector<Row>& rows, size_t refYear);
+  void computeTrends(size_t refYear);
+
+  const std::string& word(Row row) const { return _words[row]; }
+  bool hasType(Row row, KeywordType type) const {
+    return _types[row] & (1u << type);
+  }
+  std::vector<KeywordType> types(Row row) const;
+  // types joined by ", "
+  std::string typesToString(Row row) const;
+  uint64_t totalCitations(Row row) const { return _totalCitations[row]; }
+  double zScore(Row row) const { return _zScores[row]; }
+  size_t nPapers(Row row) const { return _nPapers[row]; }
+  // least-squares slope of the citations, in citations per year
+  double slope(Row row) const { return _slopes[row]; }
+  // compound annual growth rate of the citations
+  double growthRate(Row row) const { return _growthRates[row]; }
+  // slope of the last trendYears years minus the slope of the ones before
+  double acceleration(Row row) const { return _accelerations[row]; }
+  // fraction of the citations of the reference year, derived from the sum
+  // so that a change of the sum does not touch the other rows
+  double share(Row row) const {
+    return _refYearCitations == 0
+               ? 0
+               : static_cast<double>(trendCitations(row)) / _refYearCitations;
+  }
+  // impact factor of the reference year
+  double refYearImpactFactor(Row row) const {
+    return impactFactor(row, _trendRefYear);
+  }
+  // distribution of the total citations of the papers: h papers with at least
+  // h citations each; g papers with at least g^2 citations together; the
+  // median; the citations of the paper at the top 10% (nearest rank)
+  uint32_t hIndex(Row row) const { return _hIndexes[row]; }
+  uint32_t gIndex(Row row) const { return _gIndexes[row]; }
+  double medianCitations(Row row) const { return _medianCitations[row]; }
+  uint32_t topDecileCitations(Row row) const {
+    return _topDecileCitations[row];
+  }
+  static constexpr size_t trendYears = 3;
+
+  // Registers a paper counted by the summaries
+  PaperId addPaper(const std::string& doi, size_t year, size_t citations);
+  // True if the paper is counted by the store
+  bool knowsPaper(const std::string& doi) const {
+    return _paperIds.count(doi);
+  }
+  // Id of a paper counted by the store, npos if unknown
+  PaperId findPaper(const std::string& doi) const;
+  // Number of papers counted by the store, their ids are [0, nKnownPapers())
+  size_t nKnownPapers() const { return _paperDois.size(); }
+
+  // detail
+  const PaperSet& papers(Row row) const { return _papers[row]; }
+  bool hasPaper(Row row, const std::string& doi) const;
+  const std::string& paperDoi(PaperId id) const { return _paperDois[id]; }
+  size_t paperYear(PaperId id) const { return _paperYears[id]; }
+  size_t paperCitations(PaperId id) const { return _paperCitations[id]; }
+
+  // Years covered by the matrices, firstYear() > lastYear() if empty
+  size_t firstYear() const { return _firstYear; }
+  size_t lastYear() const { return _firstYear + _nYears - 1; }
+  size_t nYears() const { return _nYears; }
+  // Years with citation data of a keyword, the series of the z-score
+  std::pair<size_t, size_t> citationYears(Row row) const;
+  // Years with citations or new papers of a keyword
+  std::pair<size_t, size_t> yearSpan(Row row) const;
+
+  // Per-year metrics, zero outside of the years of the store
+  uint32_t citations(Row row, size_t year) const {
+    return valueIn(_citations, row, year);
+  }
+  uint32_t newPapers(Row row, size_t year) const {
+    return valueIn(_newPapers, row, year);
+  }
+  // citations received in a year by the papers of the two previous years
+  uint32_t ifCitations(Row row, size_t year) const {
+    return valueIn(_ifCitations, row, year);
+  }
+  // two-year impact factor, precomputed by computeTrends
+  double impactFactor(Row row, size_t year) const {
+    return year >= _firstYear && year < _firstYear + _nYears
+               ? _impactFactors[row * _nYears + (year - _firstYear)]
+               : 0;
+  }
+
+  // Windowed metrics over the years of a range inside the years of the store,
+  // O(1) from the prefix sums of the series computed by computeTrends:
+  // - the citations and the new papers of the years of the range
+  // - the z-score of the citations of range.to (and the year before) against
+  //   the years of the range with citation data; range.to is at most the
+  //   refYear of the trends, as for the z-score of all the years
+  // - the impact factor of the range: the citations received in its years by
+  //   the papers of the two previous years of each, per such paper
+  uint64_t citationsIn(Row row, const YearRange& range) const;
+  uint64_t newPapersIn(Row row, const YearRange& range) const;
+  double zScoreIn(Row row, const YearRange& range) const;
+  double impactFactorIn(Row row, const YearRange& range) const;
+
+  // Contiguous series of a keyword, nYears() values from firstYear()
+  const uint32_t* citationsRow(Row row) const {
+    return _citations.data() + row * _nYears;
+  }
+  const uint32_t* newPapersRow(Row row) const {
+    return _newPapers.data() + row * _nYears;
+  }
+  const double* impactFactorsRow(Row row) const {
+    return _impactFactors.data() + row * _nYears;
+  }
+
+ private:
+  friend class KeywordSnapshot;
+
+  Row appendRow(const std::string& word);
+  // The word, or the word with the first free suffix " (n)"
+  std::string uniqueWord(const std::string& word) const;
+  // Widens the matrices so that they cover [first, last]
+  void ensureYears(size_t first, size_t last);
+  void extendPaperYears(Row row, size_t first, size_t last);
+  // Adds the detail of a result to a row, returns the papers added
+  PaperSet mergeDetail(Row row, const KeywordQueryResult& kqr);
+  // Adds papers to a row, updating its new papers per year; returns the
+  // papers that were not in the row
+  PaperSet addPapers(Row row, const PaperSet& papers);
+  // Queues the citations of papers added to a row, see sortPaperCitations
+  void addPaperCitations(Row row, const PaperSet& papers);
+  // Moves the queued citations into the arrays of their rows, sorting the
+  // arrays that changed, in parallel blocks
+  void sortPaperCitations();
+  // Moves the queued citations into copies of the arrays of their rows, kept
+  // apart from the contiguous arrays: O(changed rows)
+  void movePaperCitations();
+  // Sorted citations of the papers of a row and their number
+  std::pair<const uint32_t*, size_t> paperCitationList(Row row) const;
+  void computeRowTrend(Row row, size_t refYear);
+  // Citations of the reference year of a row as of its last trend pass, the
+  // part of the row in _refYearCitations
+  uint64_t trendCitations(Row row) const {
+    return _trendRefYear >= _firstYear && _trendRefYear <= lastYear()
+               ? sumIn(_citationSums, row, _trendRefYear, _trendRefYear)
+               : 0;
+  }
+  uint32_t valueIn(const Column<uint32_t>& matrix, Row row,
+                   size_t year) const {
+    return year >= _firstYear && year < _firstYear + _nYears
+               ? matrix[row * _nYears + (year - _firstYear)]
+               : 0;
+  }
+  uint32_t& cell(Column<uint32_t>& matrix, Row row, size_t year) {
+    return matrix[row * _nYears + (year - _firstYear)];
+  }
+  // Sum of a prefix-sum matrix over [from, to], years of the store
+  template <typename T>
+  T sumIn(const std::vector<T>& sums, Row row, size_t from, size_t to) const {
+    const T* rowSums = sums.data() + row * (_nYears + 1);
+    return rowSums[to - _firstYear + 1] - rowSums[from - _firstYear];
+  }
+  // range clamped to the years of the store, from > to if empty
+  std::pair<size_t, size_t> clamp(const YearRange& range) const;
+
+  size_t _version = 0;
+
+  // keyword columns; the fixed-size ones may be views of a snapshot
+  std::vector<std::string> _words;
+  Column<uint8_t> _types;
+  Column<uint64_t> _totalCitations;
+  Column<double> _zScores;
+  // years with citation data, _citationFrom > _citationTo if none
+  Column<uint16_t> _citationFrom;
+  Column<uint16_t> _citationTo;
+  Column<uint32_t> _nPapers;
+  // publication years of the papers, _paperFrom > _paperTo if none
+  Column<uint16_t> _paperFrom;
+  Column<uint16_t> _paperTo;
+  // trend metrics, derived from _citations: not in the snapshot, computed
+  // again after loading it
+  std::vector<double> _slopes;
+  std::vector<double> _growthRates;
+  std::vector<double> _accelerations;
+  // citations of the reference year summed over the rows not removed
+  uint64_t _refYearCitations = 0;
+  size_t _trendRefYear = 0;
+  // last year of the store at the last full pass, the end of the trend
+  // windows when it is before the reference year
+  size_t _trendLastYear = 0;
+  // citation distribution, derived from the arrays below
+  std::vector<uint32_t> _hIndexes;
+  std::vector<uint32_t> _gIndexes;
+  std::vector<double> _medianCitations;
+  std::vector<uint32_t> _topDecileCitations;
+  // total citations of the papers of the rows, one array per row sorted in
+  // decreasing order, ending at _paperCitationEnds[row]
+  Column<uint64_t> _paperCitationEnds;
+  Column<uint32_t> _paperCitationLists;
+  // arrays of the rows changed by updateTrends, sorted, replacing theirs in
+  // _paperCitationLists until the next sortPaperCitations
+  std::unordered_map<Row, std::vector<uint32_t>> _movedPaperCitations;
+  // (row, citations) added since the last sortPaperCitations
+  std::vector<std::pair<Row, uint32_t>> _pendingPaperCitations;
+  std::vector<uint8_t> _hasDetail;
+  std::vector<uint8_t> _removed;
+  size_t _nRemoved = 0;
+  std::vector<PaperSet> _papers;
+  std::unordered_map<std::string, Row> _wordToRow;
+
+  // keyword x year matrices, row-major
+  size_t _firstYear = 1;
+  size_t _nYears = 0;
+  Column<uint32_t> _citations;
+  Column<uint32_t> _newPapers;
+  Column<uint32_t> _ifCitations;
+  // derived from _newPapers and _ifCitations, as the trends
+  std::vector<double> _impactFactors;
+  // prefix sums of the series, nYears() + 1 per row starting with 0: the sum
+  // over the years [firstYear(), year) is at year - firstYear(). Derived as
+  // the trends; the paper counts fit 32 bits, the sums of citations do not
+  std::vector<uint64_t> _citationSums;
+  std::vector<uint64_t> _citationSquareSums;
+  std::vector<uint32_t> _newPaperSums;
+  std::vector<uint64_t> _ifCitationSums;
+
+  // paper columns, indexed by PaperId
+  std::vector<std::string> _paperDois;
+  Column<uint16_t> _paperYears;
+  Column<uint32_t> _paperCitations;
+  std::unordered_map<std::string, PaperId> _paperIds;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Compressed set of dense paper ids, in the style of Roaring bitmaps: the ids
+// are split by their upper 16 bits into containers, each one either a sorted
+// array of the lower 16 bits (sparse) or a 65536-bit bitmap (dense).
+// Union, intersection, difference and cardinality work container by
+// container, word by word on bitmaps.
+class PaperSet {
+ public:
+  using Id = uint32_t;
+
+  // ids must be sorted and unique
+  static PaperSet fromSorted(const std::vector<Id>& ids);
+
+  void add(Id id);
+  bool contains(Id id) const;
+  size_t cardinality() const;
+  bool empty() const { return _containers.empty(); }
+
+  PaperSet& operator|=(const PaperSet& other);
+  PaperSet operator|(const PaperSet& other) const;
+  PaperSet operator&(const PaperSet& other) const;
+  // ids of this set missing from other
+  PaperSet operator-(const PaperSet& other) const;
+
+  // Calls f(id) for every id, in increasing order
+  template <typename F>
+  void forEach(F f) const {
+    for (const auto& c : _containers) {
+      Id high = static_cast<Id>(c.key) << 16;
+      if (c.isBitmap()) {
+        for (size_t w = 0; w < bitmapWords; w++) {
+          for (uint64_t word = c.bitmap[w]; word; word &= word - 1) {
+            f(high | (w * 64 + __builtin_ctzll(word)));
+          }
+        }
+      } else {
+        for (uint16_t low : c.array) {
+          f(high | low);
+        }
+      }
+    }
+  }
+  std::vector<Id> toVector() const;
+
+  // Bytes used by the set, for diagnostics
+  size_t memoryUsage() const;
+
+ private:
+  static constexpr size_t bitmapWords = 1024;
+  // above this cardinality a bitmap is smaller than an array
+  static constexpr size_t arrayMax = 4096;
+
+  // most keywords have a handful of papers, so the container is kept small:
+  // the bitmap is allocated only when needed
+  struct Container {
+    uint16_t key = 0;
+    uint32_t cardinality = 0;
+    // sorted lower bits, used while cardinality <= arrayMax
+    std::vector<uint16_t> array;
+    // bitmapWords words otherwise
+    std::unique_ptr<uint64_t[]> bitmap;
+
+    Container() = default;
+    Container(const Container& other);
+    Container& operator=(const Container& other);
+    Container(Container&&) = default;
+    Container& operator=(Container&&) = default;
+
+    bool isBitmap() const { return bitmap != nullptr; }
+    bool contains(uint16_t low) const;
+    void toBitmap();
+    // switches to the smaller representation for the cardinality
+    void normalize();
+  };
+
+  static Container unite(const Container& a, const Container& b);
+  static Container intersect(const Container& a, const Container& b);
+  static Container subtract(const Container& a, const Container& b);
+
+  // sorted by key
+  std::vector<Container> _containers;
+};
@@ -1,38 +1,639 @@
 #include "db.hh"
 
 #include <SQLiteCpp/SQLiteCpp.h>
+#include <SQLiteCpp/Savepoint.h>
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <regex>
+#include <thread>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 
 #include "DBPayload.hh"
 #include "SQLiteCpp/Database.h"
 #include "bibtexentry.hpp"
+#include "dbFunctions.hh"
 #include "dbUtils.hh"
 #include "globals.hh"
+#include "keywordCanonicalizer.hh"
+#include "keywordExpression.hh"
+#include "keywordSnapshot.hh"
+#include "keywordStatsVTab.hh"
 #include "message.hh"
 #include "misc.hh"
 
 // Creates a harmless, temporary database in RAM that gets overwritten later
 SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
 
-static std::vector<KeywordQueryResult> all_words;
+static KeywordStore all_words;
+static KeywordStore all_authors;
+static KeywordCooccurrence cooccurrence;
+// keyword stores of the institutions, countries and venues, by lowercase name
+static std::map<std::pair<SliceDimension, std::string>, KeywordStore> slices;
+// true once the slices of all the venues are in slices, see
+// aggregateVenueSlices
+static bool venueSlicesAggregated = false;
+
+static void loadKeywordSummaries(KeywordStore& store);
+
+// Canonicalization of the keywords, with the synonyms of --synonyms loaded on
+// first use
+static const KeywordCanonicalizer& getCanonicalizer() {
+  static KeywordCanonicalizer canonicalizer = [] {
+    KeywordCanonicalizer ret;
+    messageErrorIf(
+        !clc::synonymsFile.empty() && !ret.loadSynonyms(clc::synonymsFile),
+        "Can not read synonym file '" + clc::synonymsFile + "'");
+    return ret;
+  }();
+  return canonicalizer;
+}
+
+KeywordStore::Row addKQR(const std::string& word,
+                         const std::vector<KeywordStore::Row>& rows) {
+  for (KeywordStore::Row from : rows) {
+    loadKeywordDetail(from);
+  }
+  KeywordStore::Row row = all_words.addUnion(word, rows);
+  all_words.computeZScore(row, getCurrentYear() - 1);
+  all_words.computeTrend(row, getCurrentYear() - 1);
+  return row;
+}
+void removeKQR(KeywordStore::Row row) { all_words.remove(row); }
+
+static std::string getSnapshotPath() { return clc::dbFile + ".snapshot"; }
+
+// Key of the keyword snapshot: papers are only ever added, so the row counts
+// and last row ids of the tables change with the content of the databases.
+// The z-scores depend on the reference year and the keywords on the
+// canonicalization too
+static uint64_t getSnapshotKey(size_t refYear) {
+  uint64_t key = KeywordSnapshot::hash(std::to_string(refYear));
+  key = KeywordSnapshot::hash(
+      std::to_string(getCanonicalizer().signature()), key);
+  for (auto* database : getDatabases()) {
+    key = KeywordSnapshot::hash(database->getFilename(), key);
+    for (const char* table : {"paper", "citations", "index_term_paper",
+                              "author_keyword_paper", "area_paper"}) {
+      SQLite::Statement query(*database,
+                              std::string("SELECT count(*), max(rowid) FROM ") +
+                                  table);
+      query.executeStep();
+      key = KeywordSnapshot::hash(query.getColumn(0).getString() + ":" +
+                                      query.getColumn(1).getString(),
+                                  key);
+    }
+  }
+  return key;
+}
+
+KeywordStore& getKeywordStore() {
+  if (all_words.empty()) {
+    size_t refYear = getCurrentYear() - 1;
+    uint64_t key = getSnapshotKey(refYear);
+    if (KeywordSnapshot::load(all_words, getSnapshotPath(), key)) {
+      all_words.computeTrends(refYear);
+      return all_words;
+    }
+    loadKeywordSummaries(all_words);
+    all_words.computeZScores(refYear);
+    all_words.computeTrends(refYear);
+    if (!all_words.empty() &&
+        !KeywordSnapshot::save(all_words, getSnapshotPath(), key)) {
+      messageWarning("Could not write the keyword snapshot " +
+                     getSnapshotPath());
+    }
+  }
+  return all_words;
+}
 
-void addKQR(const KeywordQueryResult& kqr) { all_words.push_back(kqr); }
-void removeKQR(const KeywordQueryResult& kqr) {
-  all_words.erase(std::remove_if(all_words.begin(), all_words.end(),
-                                 [&kqr](const KeywordQueryResult& kqr2) {
-                                   return kqr2._word == kqr._word;
-                                 }),
-                  all_words.end());
+// Shards of the database, one per dataset, keyed by dataset name
+static std::map<std::string, std::unique_ptr<SQLite::Database>> shards;
+
+// How long a connection waits for the writer of another connection
+static const int busyTimeoutMs = 10000;
+
+// WAL lets the GUI keep reading while a background ingest writes
+static void enableWAL(SQLite::Database& database) {
+  database.exec("PRAGMA journal_mode = WAL;");
+  database.setBusyTimeout(busyTimeoutMs);
+}
+
+void createTables(SQLite::Database& database) {
+  // Create the paper table
+  database.exec(
+      "CREATE TABLE IF NOT EXISTS paper ("
+      "doi TEXT PRIMARY KEY, "
+      "title TEXT NOT NULL, "
+      "year INTEGER NOT NULL, "
+      "authors_list TEXT NOT NULL, "
+      "abstract TEXT NOT NULL, "
+      "total_citations INTEGER NOT NULL);");
+
+  // Create the citations table
+  database.exec(
+      "CREATE TABLE IF NOT EXISTS citations ("
+      "doi TEXT, "
+      "year INTEGER, "
+      "number INTEGER, "
+      "PRIMARY KEY (doi, year), "
+      "FOREIGN KEY (doi) REFERENCES paper(doi));");
+
+  // Create the index_term_paper table
+  database.exec(
+      "CREATE TABLE IF NOT EXISTS index_term_paper ("
+      "index_term TEXT, "
+      "doi TEXT, "
+      "PRIMARY KEY (index_term, doi), "
+      "FOREIGN KEY (doi) REFERENCES paper(doi));");
+
+  // Create the author_keyword_paper table
+  database.exec(
+      "CREATE TABLE IF NOT EXISTS author_keyword_paper ("
+      "author_keyword TEXT, "
+      "doi TEXT, "
+      "PRIMARY KEY (author_keyword, doi), "
+      "FOREIGN KEY (doi) REFERENCES paper(doi));");
+
+  // Create the area_paper table
+  database.exec(
+      "CREATE TABLE IF NOT EXISTS area_paper ("
+      "area TEXT, "
+      "doi TEXT, "
+      "PRIMARY KEY (area, doi), "
+      "FOREIGN KEY (doi) REFERENCES paper(doi));");
+
+  // Create the author table, the names are interned: the unique index also
+  // serves the prefix searches (case insensitive, as LIKE)
+  database.exec(
+      "CREATE TABLE IF NOT EXISTS author ("
+      "id INTEGER PRIMARY KEY, "
+      "name TEXT NOT NULL UNIQUE COLLATE NOCASE);");
+
+  // Create the author_paper table, position 1 is the first author
+  database.exec(
+      "CREATE TABLE IF NOT EXISTS author_paper ("
+      "author_id INTEGER, "
+      "doi TEXT, "
+      "position INTEGER NOT NULL, "
+      "PRIMARY KEY (author_id, doi), "
+      "FOREIGN KEY (author_id) REFERENCES author(id), "
+      "FOREIGN KEY (doi) REFERENCES paper(doi));");
+  database.exec(
+      "CREATE INDEX IF NOT EXISTS author_paper_doi ON author_paper (doi);");
+
+  // Create the country and institution tables, interned as the authors; an
+  // institution is named in its country
+  database.exec(
+      "CREATE TABLE IF NOT EXISTS country ("
+      "id INTEGER PRIMARY KEY, "
+      "name TEXT NOT NULL UNIQUE COLLATE NOCASE);");
+  database.exec(
+      "CREATE TABLE IF NOT EXISTS institution ("
+      "id INTEGER PRIMARY KEY, "
+      "name TEXT NOT NULL COLLATE NOCASE, "
+      "country_id INTEGER NOT NULL, "
+      "UNIQUE (name, country_id), "
+      "FOREIGN KEY (country_id) REFERENCES country(id));");
+
+  // Create the country_paper and institution_paper tables, keyed by the id
+  // first: the papers of a slice are a range of the primary key
+  database.exec(
+      "CREATE TABLE IF NOT EXISTS country_paper ("
+      "country_id INTEGER, "
+      "doi TEXT, "
+      "PRIMARY KEY (country_id, doi), "
+      "FOREIGN KEY (country_id) REFERENCES country(id), "
+      "FOREIGN KEY (doi) REFERENCES paper(doi));");
+  database.exec(
+      "CREATE TABLE IF NOT EXISTS institution_paper ("
+      "institution_id INTEGER, "
+      "doi TEXT, "
+      "PRIMARY KEY (institution_id, doi), "
+      "FOREIGN KEY (institution_id) REFERENCES institution(id), "
+      "FOREIGN KEY (doi) REFERENCES paper(doi));");
+
+  // Create the venue table, interned as the countries, and the venue_paper
+  // table keyed by the id first as the other slices
+  database.exec(
+      "CREATE TABLE IF NOT EXISTS venue ("
+      "id INTEGER PRIMARY KEY, "
+      "name TEXT NOT NULL UNIQUE COLLATE NOCASE);");
+  database.exec(
+      "CREATE TABLE IF NOT EXISTS venue_paper ("
+      "venue_id INTEGER, "
+      "doi TEXT, "
+      "PRIMARY KEY (venue_id, doi), "
+      "FOREIGN KEY (venue_id) REFERENCES venue(id), "
+      "FOREIGN KEY (doi) REFERENCES paper(doi));");
+
+  // Create the keyword_variant table, the keywords as they were written
+  // before the canonicalization
+  database.exec(
+      "CREATE TABLE IF NOT EXISTS keyword_variant ("
+      "variant TEXT PRIMARY KEY, "
+      "keyword TEXT NOT NULL);");
+  database.exec(
+      "CREATE INDEX IF NOT EXISTS keyword_variant_keyword "
+      "ON keyword_variant (keyword);");
+
+  // Signature of the canonicalization of the keywords stored, see
+  // canonicalizeKeywords
+  database.exec(
+      "CREATE TABLE IF NOT EXISTS keyword_canonicalization ("
+      "signature TEXT NOT NULL);");
+}
+
+// Trimmed, with single spaces
+static std::string normalizeSpaces(const std::string& str) {
+  std::string ret;
+  for (char c : str) {
+    if (!std::isspace(static_cast<unsigned char>(c))) {
+      ret += c;
+    } else if (!ret.empty() && ret.back() != ' ') {
+      ret += ' ';
+    }
+  }
+  if (!ret.empty() && ret.back() == ' ') {
+    ret.pop_back();
+  }
+  return ret;
+}
+
+std::vector<std::string> splitAuthors(const std::string& authorsList) {
+  std::vector<std::string> authors;
+  size_t begin = 0;
+  while (begin <= authorsList.size()) {
+    size_t end = authorsList.find(" and ", begin);
+    if (end == std::string::npos) {
+      end = authorsList.size();
+    }
+    std::string author =
+        normalizeSpaces(authorsList.substr(begin, end - begin));
+    if (!author.empty() && author != "others") {
+      authors.push_back(author);
+    }
+    begin = end + 5;
+  }
+  return authors;
+}
+
+// Inserts the authors of a paper, interning their names
+static void insertAuthors(const std::string& doi,
+                          const std::string& authorsList,
+                          SQLite::Database& database) {
+  SQLite::Statement intern(database,
+                           "INSERT OR IGNORE INTO author (name) VALUES (?)");
+  // an author listed twice keeps the first position
+  SQLite::Statement link(database,
+                         "INSERT OR IGNORE INTO author_paper (author_id, doi, "
+                         "position) SELECT id, ?, ? FROM author WHERE name = ?");
+  int position = 1;
+  for (const auto& author : splitAuthors(authorsList)) {
+    intern.bind(1, author);
+    intern.exec();
+    intern.reset();
+    link.bind(1, doi);
+    link.bind(2, position++);
+    link.bind(3, author);
+    link.exec();
+    link.reset();
+  }
+}
+
+// Whether a part of an affiliation names an institution, in two tiers so
+// that "School of Engineering, Brown University" is Brown University
+static bool namesInstitution(const std::string& part, bool strong) {
+  static const std::vector<std::string> strongWords = {
+      "univ", "institut", "college", "polytechn", "academ", "ecole"};
+  static const std::vector<std::string> weakWords = {
+      "school", "laborator", "labs", "research", "inc.", "corp", "ltd",
+      "gmbh",   "company"};
+  std::string lower = toLower(part);
+  for (const auto& word : strong ? strongWords : weakWords) {
+    if (lower.find(word) != std::string::npos) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::pair<std::string, std::string> parseAffiliation(
+    const std::string& affiliation) {
+  std::vector<std::string> parts;
+  for (const auto& part : split(affiliation, ',')) {
+    std::string normalized = normalizeSpaces(part);
+    if (!normalized.empty()) {
+      parts.push_back(normalized);
+    }
+  }
+  // a single part is neither an address nor a country
+  if (parts.size() < 2) {
+    return {};
+  }
+  std::string country = parts.back();
+  parts.pop_back();
+  for (bool strong : {true, false}) {
+    for (const auto& part : parts) {
+      if (namesInstitution(part, strong)) {
+        return {part, country};
+      }
+    }
+  }
+  return {parts.front(), country};
+}
+
+// Inserts the institutions and countries of a paper, interning their names
+static void insertAffiliations(const std::string& doi,
+                               const std::vector<std::string>& affiliations,
+                               SQLite::Database& database) {
+  SQLite::Statement internCountry(
+      database, "INSERT OR IGNORE INTO country (name) VALUES (?)");
+  SQLite::Statement linkCountry(
+      database,
+      "INSERT OR IGNORE INTO country_paper (country_id, doi) "
+      "SELECT id, ? FROM country WHERE name = ?");
+  SQLite::Statement internInstitution(
+      database,
+      "INSERT OR IGNORE INTO institution (name, country_id) "
+      "SELECT ?, id FROM country WHERE name = ?");
+  SQLite::Statement linkInstitution(
+      database,
+      "INSERT OR IGNORE INTO institution_paper (institution_id, doi) "
+      "SELECT institution.id, ? FROM institution JOIN country ON "
+      "country.id = institution.country_id WHERE institution.name = ? AND "
+      "country.name = ?");
+  for (const auto& affiliation : affiliations) {
+    auto [institution, country] = parseAffiliation(affiliation);
+    if (country.empty()) {
+      continue;
+    }
+    internCountry.bind(1, country);
+    internCountry.exec();
+    internCountry.reset();
+    linkCountry.bind(1, doi);
+    linkCountry.bind(2, country);
+    linkCountry.exec();
+    linkCountry.reset();
+    internInstitution.bind(1, institution);
+    internInstitution.bind(2, country);
+    internInstitution.exec();
+    internInstitution.reset();
+    linkInstitution.bind(1, doi);
+    linkInstitution.bind(2, institution);
+    linkInstitution.bind(3, country);
+    linkInstitution.exec();
+    linkInstitution.reset();
+  }
+}
+
+// A word of capitals, digits and dashes, e.g. "DATE" or "ASP-DAC"
+static bool isAcronym(const std::string& word) {
+  if (word.size() < 2 || word.size() > 16 ||
+      word.find(' ') != std::string::npos) {
+    return false;
+  }
+  bool hasLetter = false;
+  for (char c : word) {
+    if (std::isupper(static_cast<unsigned char>(c))) {
+      hasLetter = true;
+    } else if (!std::isdigit(static_cast<unsigned char>(c)) && c != '-' &&
+               c != '/') {
+      return false;
+    }
+  }
+  return hasLetter;
+}
+
+std::string venueName(const std::string& journal,
+                      const std::string& abbrevSourceTitle) {
+  const std::string& source = journal.empty() ? abbrevSourceTitle : journal;
+  // the years of the editions, a number of 4 digits alone
+  std::string withoutYears;
+  for (size_t i = 0; i < source.size();) {
+    size_t end = i;
+    while (end < source.size() &&
+           std::isdigit(static_cast<unsigned char>(source[end]))) {
+      end++;
+    }
+    bool alone =
+        end - i == 4 &&
+        (i == 0 || !std::isalnum(static_cast<unsigned char>(source[i - 1]))) &&
+        (end == source.size() ||
+         !std::isalnum(static_cast<unsigned char>(source[end])));
+    if (end > i) {
+      if (!alone) {
+        withoutYears += source.substr(i, end - i);
+      }
+      i = end;
+    } else {
+      withoutYears += source[i++];
+    }
+  }
+  std::string name = normalizeSpaces(withoutYears);
+
+  size_t comma = name.rfind(',');
+  if (comma != std::string::npos) {
+    std::string last = normalizeSpaces(name.substr(comma + 1));
+    if (isAcronym(last)) {
+      return last;
+    }
+  }
+  for (const std::string prefix :
+       {"Proceedings of the ", "Proceedings - ", "Proceedings -"}) {
+    if (name.size() > prefix.size() && name.rfind(prefix, 0) == 0) {
+      return normalizeSpaces(name.substr(prefix.size()));
+    }
+  }
+  return name;
+}
+
+// Inserts the venue of a paper, interning its name
+static void insertVenue(const std::string& doi, const std::string& venue,
+                        SQLite::Database& database) {
+  if (venue.empty()) {
+    return;
+  }
+  SQLite::Statement intern(database,
+                           "INSERT OR IGNORE INTO venue (name) VALUES (?)");
+  intern.bind(1, venue);
+  intern.exec();
+  SQLite::Statement link(database,
+                         "INSERT OR IGNORE INTO venue_paper (venue_id, doi) "
+                         "SELECT id, ? FROM venue WHERE name = ?");
+  link.bind(1, doi);
+  link.bind(2, venue);
+  link.exec();
+}
+
+// Fills the author tables of a database created before them from the author
+// lists of its papers
+static void backfillAuthors(SQLite::Database& database) {
+  SQLite::Statement linked(database, "SELECT 1 FROM author_paper LIMIT 1");
+  SQLite::Statement papers(database, "SELECT 1 FROM paper LIMIT 1");
+  if (linked.executeStep() || !papers.executeStep()) {
+    return;
+  }
+  messageInfo("Indexing the authors of " + database.getFilename());
+  SQLite::Transaction transaction(database);
+  SQLite::Statement query(database, "SELECT doi, authors_list FROM paper");
+  while (query.executeStep()) {
+    insertAuthors(query.getColumn(0).getString(),
+                  query.getColumn(1).getString(), database);
+  }
+  transaction.commit();
+}
+
+// The keyword columns of the paper link tables
+static const std::vector<std::pair<const char*, const char*>>
+    keywordColumns = {{"index_term_paper", "index_term"},
+                      {"author_keyword_paper", "author_keyword"},
+                      {"area_paper", "area"}};
+
+// Canonicalizes the keywords of a database stored before the
+// canonicalization or under other rules or synonyms: the links of a variant
+// move to its canonical keyword, once per paper
+static void canonicalizeKeywords(SQLite::Database& database) {
+  const KeywordCanonicalizer& canonicalizer = getCanonicalizer();
+  std::string signature = std::to_string(canonicalizer.signature());
+  SQLite::Statement stored(database,
+                           "SELECT signature FROM keyword_canonicalization");
+  if (stored.executeStep() && stored.getColumn(0).getString() == signature) {
+    return;
+  }
+
+  SQLite::Transaction transaction(database);
+  SQLite::Statement addVariant(
+      database,
+      "INSERT OR REPLACE INTO keyword_variant (variant, keyword) "
+      "VALUES (?, ?)");
+  size_t nVariants = 0;
+  for (const auto& [table, column] : keywordColumns) {
+    std::vector<std::string> keywords;
+    SQLite::Statement query(database, std::string("SELECT DISTINCT ") +
+                                          column + " FROM " + table);
+    while (query.executeStep()) {
+      keywords.push_back(query.getColumn(0).getString());
+    }
+    // the links already under the canonical keyword stay, the others are
+    // removed
+    SQLite::Statement move(database, std::string("UPDATE OR IGNORE ") + table +
+                                         " SET " + column + " = ? WHERE " +
+                                         column + " = ?");
+    SQLite::Statement removeLeft(database, std::string("DELETE FROM ") +
+                                               table + " WHERE " + column +
+                                               " = ?");
+    for (const std::string& keyword : keywords) {
+      std::string canonical = canonicalizer.canonical(keyword);
+      if (canonical == keyword || canonical.empty()) {
+        continue;
+      }
+      move.bind(1, canonical);
+      move.bind(2, keyword);
+      move.exec();
+      move.reset();
+      removeLeft.bind(1, keyword);
+      removeLeft.exec();
+      removeLeft.reset();
+      addVariant.bind(1, keyword);
+      addVariant.bind(2, canonical);
+      addVariant.exec();
+      addVariant.reset();
+      nVariants++;
+    }
+  }
+
+  // the variants recorded under other rules point to the new canonical
+  // keywords
+  std::vector<std::pair<std::string, std::string>> variants;
+  SQLite::Statement query(database,
+                          "SELECT variant, keyword FROM keyword_variant");
+  while (query.executeStep()) {
+    variants.emplace_back(query.getColumn(0).getString(),
+                          query.getColumn(1).getString());
+  }
+  SQLite::Statement removeVariant(
+      database, "DELETE FROM keyword_variant WHERE variant = ?");
+  for (const auto& [variant, keyword] : variants) {
+    std::string canonical = canonicalizer.canonical(keyword);
+    if (canonical == variant) {
+      removeVariant.bind(1, variant);
+      removeVariant.exec();
+      removeVariant.reset();
+    } else if (canonical != keyword) {
+      addVariant.bind(1, variant);
+      addVariant.bind(2, canonical);
+      addVariant.exec();
+      addVariant.reset();
+    }
+  }
+
+  database.exec("DELETE FROM keyword_canonicalization");
+  SQLite::Statement mark(
+      database, "INSERT INTO keyword_canonicalization (signature) VALUES (?)");
+  mark.bind(1, signature);
+  mark.exec();
+  transaction.commit();
+  messageInfoIf(nVariants > 0,
+                "Canonicalized " + std::to_string(nVariants) +
+                    " keywords of " + database.getFilename());
+}
+
+static std::string getShardPath(const std::string& dataset) {
+  std::filesystem::path dbPath(clc::dbFile);
+  return (dbPath.parent_path() / (dbPath.stem().u8string() + "." + dataset +
+                                  dbPath.extension().u8string()))
+      .u8string();
+}
+
+static SQLite::Database& openShard(const std::string& dataset,
+                                   const std::string& path) {
+  auto& shard = shards[dataset];
+  if (shard == nullptr) {
+    shard = std::make_unique<SQLite::Database>(
+        path, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    enableWAL(*shard);
+    createTables(*shard);
+    backfillAuthors(*shard);
+    canonicalizeKeywords(*shard);
+    registerCircusFunctions(*shard);
+  }
+  return *shard;
+}
+
+// Opens all the shards listed in the catalog of the main database
+static void openShards() {
+  SQLite::Statement query(db, "SELECT name, path FROM shard");
+  while (query.executeStep()) {
+    openShard(query.getColumn(0).getString(), query.getColumn(1).getString());
+  }
 }
 
 void openDB() {
   try {
     // Open a database file in read/write mode
     db = SQLite::Database(clc::dbFile, SQLite::OPEN_READWRITE);
+    enableWAL(db);
+    // the tables added since the database was created
+    createTables(db);
+    backfillAuthors(db);
+    canonicalizeKeywords(db);
+    registerCircusFunctions(db);
+    registerKeywordStatsModule(db);
+
+    // Catalog of the shards, empty if the database is not sharded
+    db.exec(
+        "CREATE TABLE IF NOT EXISTS shard ("
+        "name TEXT PRIMARY KEY, "
+        "path TEXT NOT NULL);");
+    openShards();
   } catch (const std::exception& e) {
     std::cerr << "Exception: " << e.what() << std::endl;
     exit(EXIT_FAILURE);
@@ -51,63 +652,72 @@ void createDB() {
     // Open a database file in create/write mode
     db = SQLite::Database(clc::dbFile,
                           SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    createTables(db);
+  } catch (const std::exception& e) {
+    std::cerr << "Exception: " << e.what() << std::endl;
+  }
+  openDB();
+}
 
-    // Create the paper table
-    db.exec(
-        "CREATE TABLE IF NOT EXISTS paper ("
-        "doi TEXT PRIMARY KEY, "
-        "title TEXT NOT NULL, "
-        "year INTEGER NOT NULL, "
-        "authors_list TEXT NOT NULL, "
-        "abstract TEXT NOT NULL, "
-        "total_citations INTEGER NOT NULL);");
-
-    // Create the citations table
-    db.exec(
-        "CREATE TABLE IF NOT EXISTS citations ("
-        "doi TEXT, "
-        "year INTEGER, "
-        "number INTEGER, "
-        "PRIMARY KEY (doi, year), "
-        "FOREIGN KEY (doi) REFERENCES paper(doi));");
-
-    // Create the index_term_paper table
-    db.exec(
-        "CREATE TABLE IF NOT EXISTS index_term_paper ("
-        "index_term TEXT, "
-        "doi TEXT, "
-        "PRIMARY KEY (index_term, doi), "
-        "FOREIGN KEY (doi) REFERENCES paper(doi));");
+SQLite::Database& getShard(const std::string& dataset) {
+  if (!shards.count(dataset)) {
+    std::string path = getShardPath(dataset);
+    SQLite::Statement query(
+        db, "INSERT OR IGNORE INTO shard (name, path) VALUES (?, ?)");
+    query.bind(1, dataset);
+    query.bind(2, path);
+    query.exec();
+    messageInfo("Opening shard '" + dataset + "' in " + path);
+    openShard(dataset, path);
+  }
+  return *shards.at(dataset);
+}
 
-    // Create the author_keyword_paper table
-    db.exec(
-        "CREATE TABLE IF NOT EXISTS author_keyword_paper ("
-        "author_keyword TEXT, "
-        "doi TEXT, "
-        "PRIMARY KEY (author_keyword, doi), "
-        "FOREIGN KEY (doi) REFERENCES paper(doi));");
+std::unique_ptr<SQLite::Database> openConnection(const std::string& path) {
+  auto connection =
+      std::make_unique<SQLite::Database>(path, SQLite::OPEN_READWRITE);
+  connection->setBusyTimeout(busyTimeoutMs);
+  registerCircusFunctions(*connection);
+  return connection;
+}
 
-    // Create the area_paper table
-    db.exec(
-        "CREATE TABLE IF NOT EXISTS area_paper ("
-        "area TEXT, "
-        "doi TEXT, "
-        "PRIMARY KEY (area, doi), "
-        "FOREIGN KEY (doi) REFERENCES paper(doi));");
+std::vector<SQLite::Database*> getDatabases() {
+  std::vector<SQLite::Database*> databases{&db};
+  for (auto& [dataset, shard] : shards) {
+    databases.push_back(shard.get());
+  }
+  return databases;
+}
 
-  } catch (const std::exception& e) {
-    std::cerr << "Exception: " << e.what() << std::endl;
+std::string getDatasetName(const std::string& bibFile) {
+  return std::filesystem::path(bibFile).stem().u8string();
+}
+
+bool paperExists(const std::string& doi) {
+  return paperExists(doi, getDatabases());
+}
+
+bool paperExists(const std::string& doi,
+                 const std::vector<SQLite::Database*>& databases) {
+  for (SQLite::Database* database : databases) {
+    SQLite::Statement query(*database, "SELECT 1 FROM paper WHERE doi = ?");
+    query.bind(1, doi);
+    if (query.executeStep()) {
+      return true;
+    }
   }
+  return false;
 }
 
-std::vector<DBPayload> getPapers(std::string keyword) {
+static std::vector<DBPayload> getPapers(const std::string& keyword,
+                                        SQLite::Database& database) {
   std::vector<DBPayload> results;
   std::set<std::string> unique_dois;
 
   try {
     // Prepare a query to search in index_term_paper
     SQLite::Statement indexTermQuery(
-        db,
+        database,
         "SELECT paper.doi, paper.title, paper.year, paper.authors_list, "
         "paper.abstract, paper.total_citations "
         "FROM index_term_paper "
@@ -116,7 +726,7 @@ std::vector<DBPayload> getPapers(std::string keyword) {
 
     // Prepare a query to search in author_keyword_paper
     SQLite::Statement authorKeywordQuery(
-        db,
+        database,
         "SELECT paper.doi, paper.title, paper.year, paper.authors_list, "
         "paper.abstract, paper.total_citations "
         "FROM author_keyword_paper "
@@ -125,7 +735,7 @@ std::vector<DBPayload> getPapers(std::string keyword) {
 
     // Prepare a query to search in area_paper
     SQLite::Statement areaQuery(
-        db,
+        database,
         "SELECT paper.doi, paper.title, paper.year, paper.authors_list, "
         "paper.abstract, paper.total_citations "
         "FROM area_paper "
@@ -150,7 +760,7 @@ std::vector<DBPayload> getPapers(std::string keyword) {
 
         // Query for citations associated with the paper
         SQLite::Statement citationQuery(
-            db, "SELECT year, number FROM citations WHERE doi = ?");
+            database, "SELECT year, number FROM citations WHERE doi = ?");
         citationQuery.bind(1, payload.doi);
         while (citationQuery.executeStep()) {
           int year = citationQuery.getColumn(0).getInt();
@@ -160,7 +770,7 @@ std::vector<DBPayload> getPapers(std::string keyword) {
 
         // Query for index terms associated with the paper
         SQLite::Statement indexTermQuery(
-            db, "SELECT index_term FROM index_term_paper WHERE doi = ?");
+            database, "SELECT index_term FROM index_term_paper WHERE doi = ?");
         indexTermQuery.bind(1, payload.doi);
         while (indexTermQuery.executeStep()) {
           payload.index_terms.push_back(
@@ -169,7 +779,7 @@ std::vector<DBPayload> getPapers(std::string keyword) {
 
         // Query for author keywords associated with the paper
         SQLite::Statement authorKeywordQuery(
-            db,
+            database,
             "SELECT author_keyword FROM author_keyword_paper WHERE doi = ?");
         authorKeywordQuery.bind(1, payload.doi);
         while (authorKeywordQuery.executeStep()) {
@@ -179,7 +789,7 @@ std::vector<DBPayload> getPapers(std::string keyword) {
 
         // Query for areas associated with the paper
         SQLite::Statement areaQuery(
-            db, "SELECT area FROM area_paper WHERE doi = ?");
+            database, "SELECT area FROM area_paper WHERE doi = ?");
         areaQuery.bind(1, payload.doi);
         while (areaQuery.executeStep()) {
           payload.areas.push_back(areaQuery.getColumn(0).getString());
@@ -205,15 +815,45 @@ std::vector<DBPayload> getPapers(std::string keyword) {
   return results;
 }
 
-void insertPaper(const DBPayload& payload) {
+std::vector<DBPayload> getPapers(std::string keyword) {
+  auto databases = getDatabases();
+  std::vector<std::vector<DBPayload>> partial(databases.size());
+
+  // Query all the shards in parallel, the main database stays on the calling
+  // thread which might already own its connection
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < databases.size(); i++) {
+    workers.emplace_back(
+        [&, i]() { partial[i] = getPapers(keyword, *databases[i]); });
+  }
+  partial[0] = getPapers(keyword, *databases[0]);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  // Merge the results, a paper is stored in a single shard but skip
+  // duplicates anyway
+  std::vector<DBPayload> results;
+  std::unordered_set<std::string> unique_dois;
+  for (auto& papers : partial) {
+    for (auto& paper : papers) {
+      if (unique_dois.insert(paper.doi).second) {
+        results.push_back(std::move(paper));
+      }
+    }
+  }
+  return results;
+}
+
+bool insertPaper(const DBPayload& payload, SQLite::Database& database) {
   try {
-    // Begin a transaction
-    SQLite::Transaction transaction(db);
+    // Begin a savepoint, which also works inside the transaction of a batch
+    SQLite::Savepoint savepoint(database, "insert_paper");
 
     // Insert into paper table
     {
       SQLite::Statement query(
-          db,
+          database,
           "INSERT INTO paper (doi, title, year, authors_list, abstract, "
           "total_citations) VALUES (?, ?, ?, ?, ?, ?)");
       query.bind(1, payload.doi);
@@ -228,7 +868,7 @@ void insertPaper(const DBPayload& payload) {
     // Insert into citations table
     for (const auto& citation : payload.citations) {
       SQLite::Statement query(
-          db, "INSERT INTO citations (doi, year, number) VALUES (?, ?, ?)");
+          database, "INSERT INTO citations (doi, year, number) VALUES (?, ?, ?)");
       query.bind(1, payload.doi);
       query.bind(2, citation.first);
       query.bind(3, citation.second);
@@ -238,7 +878,9 @@ void insertPaper(const DBPayload& payload) {
     // Insert into index_term_paper table
     for (const auto& index_term : payload.index_terms) {
       SQLite::Statement query(
-          db, "INSERT INTO index_term_paper (index_term, doi) VALUES (?, ?)");
+          database,
+          "INSERT OR IGNORE INTO index_term_paper (index_term, doi) "
+          "VALUES (?, ?)");
       query.bind(1, index_term);
       query.bind(2, payload.doi);
       query.exec();
@@ -246,8 +888,8 @@ void insertPaper(const DBPayload& payload) {
 
     // Insert into author_keyword_paper table
     for (const auto& author_keyword : payload.author_keywords) {
-      SQLite::Statement query(db,
-                              "INSERT INTO author_keyword_paper "
+      SQLite::Statement query(database,
+                              "INSERT OR IGNORE INTO author_keyword_paper "
                               "(author_keyword, doi) VALUES (?, ?)");
       query.bind(1, author_keyword);
       query.bind(2, payload.doi);
@@ -257,18 +899,41 @@ void insertPaper(const DBPayload& payload) {
     // Insert into area_paper table
     for (const auto& area : payload.areas) {
       SQLite::Statement query(
-          db, "INSERT INTO area_paper (area, doi) VALUES (?, ?)");
+          database,
+          "INSERT OR IGNORE INTO area_paper (area, doi) VALUES (?, ?)");
       query.bind(1, area);
       query.bind(2, payload.doi);
       query.exec();
     }
 
-    // Commit the transaction
-    transaction.commit();
+    // Insert into keyword_variant table, a variant keeps its first canonical
+    // keyword
+    for (const auto& [variant, keyword] : payload.keyword_variants) {
+      SQLite::Statement query(database,
+                              "INSERT OR IGNORE INTO keyword_variant "
+                              "(variant, keyword) VALUES (?, ?)");
+      query.bind(1, variant);
+      query.bind(2, keyword);
+      query.exec();
+    }
+
+    // Insert into the author, institution, country and venue tables
+    insertAuthors(payload.doi, payload.authors_list, database);
+    insertAffiliations(payload.doi, payload.affiliations, database);
+    insertVenue(payload.doi, payload.venue, database);
+
+    // Commit the savepoint
+    savepoint.release();
 
   } catch (const std::exception& e) {
     std::cerr << "Exception: " << e.what() << std::endl;
+    return false;
   }
+  return true;
+}
+
+bool insertPaper(const DBPayload& payload) {
+  return insertPaper(payload, db);
 }
 
 void printPapers() {
@@ -344,9 +1009,51 @@ void printAllTables() {
             << "\n";
 }
 
+bool printQuery(const std::string& sql) {
+  try {
+    SQLite::Statement query(db, sql);
+    for (int i = 0; i < query.getColumnCount(); i++) {
+      std::cout << (i ? "\t" : "") << query.getColumnName(i);
+    }
+    std::cout << "\n";
+    while (query.executeStep()) {
+      for (int i = 0; i < query.getColumnCount(); i++) {
+        std::cout << (i ? "\t" : "") << query.getColumn(i).getString();
+      }
+      std::cout << "\n";
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Exception: " << e.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Canonical keywords of a keyword list, once each, recording the variants in
+// the payload
+static std::vector<std::string> canonicalKeywords(const std::string& list,
+                                                  DBPayload& payload) {
+  std::vector<std::string> ret;
+  for (const auto& keyword : splitFix(list, ',')) {
+    std::string canonical = getCanonicalizer().canonical(keyword);
+    if (canonical.empty()) {
+      continue;
+    }
+    if (canonical != keyword) {
+      payload.keyword_variants.emplace_back(keyword, canonical);
+    }
+    if (std::find(ret.begin(), ret.end(), canonical) == ret.end()) {
+      ret.push_back(canonical);
+    }
+  }
+  return ret;
+}
+
 DBPayload toDBPayload(const bibtex::BibTeXEntry& entry) {
   static std::unordered_set<std::string> unique_ids;
   DBPayload payload;
+  std::string journal;
+  std::string abbrevSourceTitle;
 
   // Iterate over fields of BibTeXEntry
   for (const auto& field : entry.fields) {
@@ -384,14 +1091,33 @@ DBPayload toDBPayload(const bibtex::BibTeXEntry& entry) {
                payload.total_citations == 0) {
       payload.total_citations = safeStoull(field.second.front());
     } else if (field.first == "index_terms") {
-      payload.index_terms = splitFix(field.second.front(), ',');
+      payload.index_terms = canonicalKeywords(field.second.front(), payload);
     } else if (field.first == "author_keywords") {
-      payload.author_keywords = splitFix(field.second.front(), ',');
+      payload.author_keywords =
+          canonicalKeywords(field.second.front(), payload);
     } else if (field.first == "subject_areas") {
-      payload.areas = splitFix(field.second.front(), ',');
+      payload.areas = canonicalKeywords(field.second.front(), payload);
+    } else if (field.first == "affiliations") {
+      // the names keep their case
+      payload.affiliations = split(field.second.front(), ';');
+    } else if (field.first == "journal") {
+      journal = field.second.front();
+    } else if (field.first == "abbrev_source_title") {
+      abbrevSourceTitle = field.second.front();
+    } else if (field.first == "correspondence_address" &&
+               payload.affiliations.empty()) {
+      // "Name; Affiliation; email: ...", used if there are no affiliations
+      for (const auto& part : split(field.second.front(), ';')) {
+        if (part.find(',') != std::string::npos &&
+            removeLeading(part).rfind("email:", 0) != 0) {
+          payload.affiliations.push_back(part);
+        }
+      }
     }
   }
 
+  payload.venue = venueName(journal, abbrevSourceTitle);
+
   messageWarningIf(
       payload.doi == "",
       "DOI/eid not found in BibTeX entry with title: " + payload.title);
@@ -406,224 +1132,1113 @@ DBPayload toDBPayload(const bibtex::BibTeXEntry& entry) {
   return payload;
 }
 
-KeywordQueryResult getKQR(const std::string& keyword) {
-  auto kqr = std::find_if(all_words.begin(), all_words.end(),
-                          [&keyword](const KeywordQueryResult& kqr) {
-                            return kqr._word == keyword;
-                          });
-  messageErrorIf(kqr == all_words.end(),
+KeywordStore::Row getKQR(const std::string& keyword) {
+  KeywordStore::Row row = all_words.find(keyword);
+  messageErrorIf(row == KeywordStore::npos,
                  "No data found for keyword: " + keyword);
-  return *kqr;
+  return row;
 }
 
-std::vector<KeywordQueryResult> queryAllKeywords() {
-  std::unordered_map<std::string, KeywordQueryResult> word_to_kqr;
+std::vector<std::string> getKeywordVariants(const std::string& keyword) {
+  std::set<std::string> variants;
+  for (auto* database : getDatabases()) {
+    SQLite::Statement query(
+        *database, "SELECT variant FROM keyword_variant WHERE keyword = ?");
+    query.bind(1, keyword);
+    while (query.executeStep()) {
+      variants.insert(query.getColumn(0).getString());
+    }
+  }
+  return {variants.begin(), variants.end()};
+}
 
-  // Set to keep track of DOI-keyword pairs to avoid duplicates when the same
-  // keyword is both an author keyword, index term or subject area
-  std::set<std::pair<std::string, std::string>> taken_doi_keyword;
+namespace {
+// Paper of a keyword row, loaded once with its citations per year
+struct PaperRow {
+  std::string doi;
+  size_t year;
+  size_t totalCitations;
+  std::vector<std::pair<size_t, size_t>> yearToCitations;
+};
+
+// A (keyword, paper) pair from one of the keyword tables
+struct KeywordRow {
+  std::string keyword;
+  KeywordType type;
+  size_t paper;
+};
+
+struct KeywordRows {
+  std::vector<PaperRow> papers;
+  std::vector<KeywordRow> rows;
+};
+
+// A table of (word, doi) rows: the word is column, read from table and the
+// joined tables
+struct RowSource {
+  const char* table;
+  const char* join;
+  const char* column;
+  KeywordType type;
+};
+
+// author keywords first, then index terms and subject areas: the order of the
+// rows of a keyword is the same in its partition
+const std::vector<RowSource> keywordSources = {
+    {"author_keyword_paper", "", "author_keyword", KeywordType::AuthorKeyword},
+    {"index_term_paper", "", "index_term", KeywordType::IndexTerm},
+    {"area_paper", "", "area", KeywordType::SubjectArea}};
+
+const std::vector<RowSource> authorSources = {
+    {"author_paper", " join author on author.id = author_paper.author_id",
+     "author.name", KeywordType::Author}};
+}  // namespace
+
+// Reads the papers matching paperFilter, a condition on the paper table
+// appended to the queries (empty for all the papers), with their citations
+// and the rows of the sources. If keyword is not empty only its rows are
+// read, and it is bound to :keyword in paperFilter
+static KeywordRows loadKeywordRows(
+    SQLite::Database& database, const std::string& paperFilter,
+    const std::string& keyword = "",
+    const std::vector<RowSource>& sources = keywordSources) {
+  KeywordRows ret;
+  std::unordered_map<std::string, size_t> doi_to_paper;
+  auto bindKeyword = [&keyword](SQLite::Statement& query) {
+    if (!keyword.empty()) {
+      query.bind(":keyword", keyword);
+    }
+  };
 
   try {
-    // Query for all author keywords and calculate total citations
-    {
-      SQLite::Statement query(
-          db,
-          "SELECT author_keyword, paper.doi, paper.year, paper.total_citations "
-          "FROM author_keyword_paper join "
-          "paper on author_keyword_paper.doi = paper.doi");
+    SQLite::Statement query_papers(
+        database, "SELECT doi, year, total_citations FROM paper" + paperFilter);
+    bindKeyword(query_papers);
+    while (query_papers.executeStep()) {
+      doi_to_paper.emplace(query_papers.getColumn(0).getString(),
+                           ret.papers.size());
+      ret.papers.push_back(
+          {query_papers.getColumn(0).getString(),
+           static_cast<size_t>(query_papers.getColumn(1).getInt()),
+           static_cast<size_t>(query_papers.getColumn(2).getInt()),
+           {}});
+    }
 
+    SQLite::Statement query_citations(
+        database,
+        "SELECT citations.doi, citations.year, citations.number "
+        "FROM citations join paper on citations.doi = paper.doi" +
+            paperFilter);
+    bindKeyword(query_citations);
+    while (query_citations.executeStep()) {
+      auto it = doi_to_paper.find(query_citations.getColumn(0).getString());
+      if (it != doi_to_paper.end()) {
+        ret.papers[it->second].yearToCitations.emplace_back(
+            query_citations.getColumn(1).getInt(),
+            query_citations.getColumn(2).getInt());
+      }
+    }
+
+    for (const auto& [table, join, column, type] : sources) {
+      std::string sql = std::string("SELECT ") + column + ", " + table +
+                        ".doi FROM " + table + join + " join paper on " +
+                        table + ".doi = paper.doi" + paperFilter;
+      if (!keyword.empty()) {
+        sql += std::string(paperFilter.empty() ? " WHERE " : " AND ") +
+               column + " = :keyword";
+      }
+      SQLite::Statement query(database, sql);
+      bindKeyword(query);
       while (query.executeStep()) {
-        std::string keyword = query.getColumn(0).getString();
-        std::string doi = query.getColumn(1).getString();
-        word_to_kqr[keyword]._type.insert(KeywordType::AuthorKeyword);
-        if (taken_doi_keyword.count({doi, keyword})) {
-          continue;
-        } else {
-          taken_doi_keyword.insert({doi, keyword});
-        }
-        int pubYear = query.getColumn(2).getInt();
-        int totalCitations = query.getColumn(3).getInt();
-
-        // Query for citations associated with the DOI
-        SQLite::Statement query_citations(
-            db, "SELECT year, number FROM citations WHERE doi = ?");
-        query_citations.bind(1, doi);
-        while (query_citations.executeStep()) {
-          size_t year = query_citations.getColumn(0).getInt();
-          size_t citations = query_citations.getColumn(1).getInt();
-          word_to_kqr[keyword]._yearToCitations[year] += citations;
-          if (year == pubYear + 1 || year == pubYear + 2) {
-            word_to_kqr[keyword]
-                ._yearToCitationInYearOfPapersPublishedThePreviousTwoYears
-                    [year] += citations;
-          }
+        auto it = doi_to_paper.find(query.getColumn(1).getString());
+        if (it != doi_to_paper.end()) {
+          ret.rows.push_back(
+              {query.getColumn(0).getString(), type, it->second});
         }
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Exception: " << e.what() << std::endl;
+  }
+  return ret;
+}
 
-        word_to_kqr[keyword]._totalCitations += totalCitations;
-        word_to_kqr[keyword]._yearToPapers[pubYear].insert(doi);
-        word_to_kqr[keyword]._papers.insert(doi);
-        // repeated to avoid checking for empty string
-        word_to_kqr[keyword]._word = keyword;
+// Summaries of the keywords of one partition of the rows, without the papers
+static std::vector<KeywordSummary> summarizeKeywords(
+    const std::vector<KeywordRow>& rows, const std::vector<PaperRow>& papers) {
+  std::vector<KeywordSummary> summaries;
+  std::unordered_map<std::string, size_t> word_to_summary;
+  // (summary, paper) pairs already counted, a keyword can be both an author
+  // keyword, index term or subject area of a paper
+  std::unordered_set<uint64_t> taken_keyword_paper;
+  for (const auto& row : rows) {
+    auto [it, inserted] =
+        word_to_summary.emplace(row.keyword, summaries.size());
+    if (inserted) {
+      summaries.emplace_back();
+      summaries.back()._word = row.keyword;
+    }
+    auto& summary = summaries[it->second];
+    summary._type.insert(row.type);
+    if (!taken_keyword_paper.insert(uint64_t(it->second) << 32 | row.paper)
+             .second) {
+      continue;
+    }
+
+    const auto& paper = papers[row.paper];
+    for (const auto& [year, citations] : paper.yearToCitations) {
+      summary._yearToCitations[year] += citations;
+      if (year == paper.year + 1 || year == paper.year + 2) {
+        summary._yearToIFCitations[year] += citations;
       }
     }
+    summary._totalCitations += paper.totalCitations;
+    summary._paperCitations.push_back(paper.totalCitations);
+    summary._yearToNewPapers[paper.year]++;
+    summary._nPapers++;
+    summary._firstPaperYear = std::min(summary._firstPaperYear, paper.year);
+    summary._lastPaperYear = std::max(summary._lastPaperYear, paper.year);
+  }
+  return summaries;
+}
 
-    //// Query for all index terms and calculate total citations
-    {
-      SQLite::Statement query(
-          db,
-          "SELECT index_term, paper.doi, paper.year, paper.total_citations "
-          "FROM index_term_paper join "
-          "paper on index_term_paper.doi = paper.doi");
-      while (query.executeStep()) {
-        std::string keyword = query.getColumn(0).getString();
-        std::string doi = query.getColumn(1).getString();
-        word_to_kqr[keyword]._type.insert(KeywordType::IndexTerm);
-        if (taken_doi_keyword.count({doi, keyword})) {
-          continue;
-        } else {
-          taken_doi_keyword.insert({doi, keyword});
-        }
-        int pubYear = query.getColumn(2).getInt();
-        int totalCitations = query.getColumn(3).getInt();
-
-        // Query for citations associated with the DOI
-        SQLite::Statement query_citations(
-            db, "SELECT year, number FROM citations WHERE doi = ?");
-        query_citations.bind(1, doi);
-        while (query_citations.executeStep()) {
-          size_t year = query_citations.getColumn(0).getInt();
-          size_t citations = query_citations.getColumn(1).getInt();
-          word_to_kqr[keyword]._yearToCitations[year] += citations;
-          if (year == pubYear + 1 || year == pubYear + 2) {
-            word_to_kqr[keyword]
-                ._yearToCitationInYearOfPapersPublishedThePreviousTwoYears
-                    [year] += citations;
-          }
+// Detailed statistics of the keywords of one partition of the rows
+static std::vector<KeywordQueryResult> aggregateKeywords(
+    const std::vector<KeywordRow>& rows, const std::vector<PaperRow>& papers) {
+  std::unordered_map<std::string, KeywordQueryResult> word_to_kqr;
+  for (const auto& row : rows) {
+    auto& kqr = word_to_kqr[row.keyword];
+    kqr._word = row.keyword;
+    kqr._type.insert(row.type);
+    const auto& paper = papers[row.paper];
+    // count a paper once when the keyword is both an author keyword, index
+    // term or subject area
+    if (!kqr._papers.insert(paper.doi).second) {
+      continue;
+    }
+
+    for (const auto& [year, citations] : paper.yearToCitations) {
+      kqr._yearToCitations[year] += citations;
+      if (year == paper.year + 1 || year == paper.year + 2) {
+        kqr._yearToCitationInYearOfPapersPublishedThePreviousTwoYears[year] +=
+            citations;
+      }
+    }
+    kqr._totalCitations += paper.totalCitations;
+    kqr._paperCitations.emplace(paper.doi, paper.totalCitations);
+    kqr._yearToPapers[paper.year].insert(paper.doi);
+  }
+
+  std::vector<KeywordQueryResult> ret;
+  ret.reserve(word_to_kqr.size());
+  for (auto& entry : word_to_kqr) {
+    ret.push_back(std::move(entry.second));
+  }
+  return ret;
+}
+
+// Partitions the rows by keyword hash and aggregates each partition on a
+// worker thread: a keyword is entirely in one partition, so the results are
+// concatenated, then sorted by word so that they do not depend on the
+// partitioning
+template <typename Result>
+static std::vector<Result> aggregatePartitioned(
+    KeywordRows& keywordRows,
+    std::vector<Result> (*aggregate)(const std::vector<KeywordRow>&,
+                                     const std::vector<PaperRow>&)) {
+  constexpr size_t minRowsPerPartition = 10000;
+
+  size_t nPartitions = std::max<size_t>(
+      1, std::min<size_t>(std::thread::hardware_concurrency(),
+                          keywordRows.rows.size() / minRowsPerPartition));
+  std::vector<std::vector<KeywordRow>> partitionRows(nPartitions);
+  std::hash<std::string> hash;
+  for (auto& row : keywordRows.rows) {
+    partitionRows[hash(row.keyword) % nPartitions].push_back(std::move(row));
+  }
+  keywordRows.rows.clear();
+
+  std::vector<std::vector<Result>> partial(nPartitions);
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < nPartitions; i++) {
+    workers.emplace_back([&, i]() {
+      partial[i] = aggregate(partitionRows[i], keywordRows.papers);
+    });
+  }
+  partial[0] = aggregate(partitionRows[0], keywordRows.papers);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  std::vector<Result> ret = std::move(partial.front());
+  for (size_t i = 1; i < nPartitions; i++) {
+    std::move(partial[i].begin(), partial[i].end(), std::back_inserter(ret));
+  }
+  std::sort(ret.begin(), ret.end(), [](const Result& a, const Result& b) {
+    return a._word < b._word;
+  });
+  return ret;
+}
+
+// Drops the rows of the papers not counted by the store, e.g. inserted by a
+// background ingest whose batch was not merged yet
+static void removeUnknownPapers(KeywordRows& rows, const KeywordStore& store) {
+  auto unknown = std::remove_if(
+      rows.rows.begin(), rows.rows.end(), [&](const KeywordRow& row) {
+        return !store.knowsPaper(rows.papers[row.paper].doi);
+      });
+  rows.rows.erase(unknown, rows.rows.end());
+}
+
+// Detailed statistics of the keywords of the papers matching paperFilter, see
+// loadKeywordRows; restricted to the papers of knownBy if not null
+static std::vector<KeywordQueryResult> queryKeywords(
+    SQLite::Database& database, const std::string& paperFilter,
+    const KeywordStore* knownBy = nullptr) {
+  KeywordRows rows = loadKeywordRows(database, paperFilter);
+  if (knownBy) {
+    removeUnknownPapers(rows, *knownBy);
+  }
+  return aggregatePartitioned(rows, aggregateKeywords);
+}
+
+// Adds the statistics of a keyword computed on another shard
+static void mergeKQR(KeywordQueryResult& into, const KeywordQueryResult& from) {
+  into._word = from._word;
+  into._type.insert(from._type.begin(), from._type.end());
+  for (const auto& [year, citations] : from._yearToCitations) {
+    into._yearToCitations[year] += citations;
+  }
+  for (const auto& [year, papers] : from._yearToPapers) {
+    into._yearToPapers[year].insert(papers.begin(), papers.end());
+  }
+  for (const auto& [year, citations] :
+       from._yearToCitationInYearOfPapersPublishedThePreviousTwoYears) {
+    into._yearToCitationInYearOfPapersPublishedThePreviousTwoYears[year] +=
+        citations;
+  }
+  into._totalCitations += from._totalCitations;
+  into._papers.insert(from._papers.begin(), from._papers.end());
+  into._paperCitations.insert(from._paperCitations.begin(),
+                              from._paperCitations.end());
+}
+
+// Runs f(i, database) for each database, the shards on their own thread and
+// connection; the main database stays on the calling thread which might
+// already own its connection (e.g. when warming the cache from the
+// keyword_stats virtual table)
+template <typename F>
+static void forEachDatabase(const std::vector<SQLite::Database*>& databases,
+                            F f) {
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < databases.size(); i++) {
+    workers.emplace_back([&, i]() { f(i, *databases[i]); });
+  }
+  f(0, *databases[0]);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+static std::vector<KeywordQueryResult> queryAllKeywords(
+    const KeywordStore* knownBy) {
+  auto databases = getDatabases();
+  std::vector<std::vector<KeywordQueryResult>> partial(databases.size());
+  forEachDatabase(databases, [&](size_t i, SQLite::Database& database) {
+    partial[i] = queryKeywords(database, "", knownBy);
+  });
+  if (partial.size() == 1) {
+    return std::move(partial.front());
+  }
+
+  std::map<std::string, KeywordQueryResult> word_to_kqr;
+  for (const auto& kqrs : partial) {
+    for (const auto& kqr : kqrs) {
+      mergeKQR(word_to_kqr[kqr._word], kqr);
+    }
+  }
+  // sorted by keyword, as for a single database
+  std::vector<KeywordQueryResult> ret;
+  ret.reserve(word_to_kqr.size());
+  for (auto& entry : word_to_kqr) {
+    ret.push_back(std::move(entry.second));
+  }
+  return ret;
+}
+
+std::vector<KeywordQueryResult> queryAllKeywords() {
+  return queryAllKeywords(nullptr);
+}
+
+// Fills the store with the summaries of all the keywords and the papers they
+// count
+static void loadKeywordSummaries(KeywordStore& store) {
+  auto databases = getDatabases();
+  std::vector<KeywordRows> rows(databases.size());
+  std::vector<std::vector<KeywordSummary>> partial(databases.size());
+  forEachDatabase(databases, [&](size_t i, SQLite::Database& database) {
+    rows[i] = loadKeywordRows(database, "");
+    partial[i] = aggregatePartitioned(rows[i], summarizeKeywords);
+  });
+
+  // a paper is in one database only, the summaries of a keyword in several
+  // shards are summed by the store
+  for (size_t i = 0; i < databases.size(); i++) {
+    for (const auto& paper : rows[i].papers) {
+      store.addPaper(paper.doi, paper.year, paper.totalCitations);
+    }
+    for (const auto& summary : partial[i]) {
+      store.add(summary);
+    }
+  }
+}
+
+// Detailed statistics of a keyword on all the databases, restricted to the
+// papers counted by the store so that they match its summary
+static KeywordQueryResult queryKeywordDetail(const std::string& keyword,
+                                             const KeywordStore& store) {
+  const std::string filter =
+      " WHERE paper.doi IN ("
+      "SELECT doi FROM author_keyword_paper WHERE author_keyword = :keyword "
+      "UNION SELECT doi FROM index_term_paper WHERE index_term = :keyword "
+      "UNION SELECT doi FROM area_paper WHERE area = :keyword)";
+
+  KeywordQueryResult ret;
+  ret._word = keyword;
+  for (auto* database : getDatabases()) {
+    KeywordRows rows = loadKeywordRows(*database, filter, keyword);
+    removeUnknownPapers(rows, store);
+    for (const auto& kqr : aggregateKeywords(rows.rows, rows.papers)) {
+      mergeKQR(ret, kqr);
+    }
+  }
+  return ret;
+}
+
+void loadKeywordDetail(KeywordStore::Row row) {
+  if (!all_words.isRemoved(row) && !all_words.hasDetail(row)) {
+    all_words.setDetail(row, queryKeywordDetail(all_words.word(row), all_words));
+  }
+}
+
+void loadAllKeywordDetails() {
+  KeywordStore& store = getKeywordStore();
+  for (KeywordStore::Row row = 0; row < store.size(); row++) {
+    if (!store.isRemoved(row) && !store.hasDetail(row)) {
+      // a single aggregation is faster than one query per keyword
+      for (const auto& kqr : queryAllKeywords(&store)) {
+        KeywordStore::Row kqrRow = store.find(kqr._word);
+        if (kqrRow != KeywordStore::npos && !store.hasDetail(kqrRow)) {
+          store.setDetail(kqrRow, kqr);
         }
-        word_to_kqr[keyword]._totalCitations += totalCitations;
-        word_to_kqr[keyword]._yearToPapers[pubYear].insert(doi);
-        word_to_kqr[keyword]._papers.insert(doi);
-        word_to_kqr[keyword]._word = keyword;
       }
+      return;
     }
+  }
+}
 
-    // Query for all subject areas and calculate total citations
-    {
-      SQLite::Statement query(
-          db,
-          "SELECT area, paper.doi, paper.year, paper.total_citations "
-          "FROM area_paper join "
-          "paper on area_paper.doi = paper.doi");
+namespace {
+// Citations per year of the papers counted by the cached store: the
+// (year, citations) pairs of paper id are [ends[id], ends[id + 1]) of
+// yearCitations
+struct PaperCitationYears {
+  std::vector<uint64_t> ends;
+  std::vector<std::pair<uint16_t, uint32_t>> yearCitations;
+  size_t nPapers() const { return ends.empty() ? 0 : ends.size() - 1; }
+};
+}  // namespace
+
+// Read from all the databases on the first keyword expression, and again once
+// the store counts more papers
+static const PaperCitationYears& getPaperCitationYears(
+    const KeywordStore& store) {
+  static PaperCitationYears index;
+  if (!index.ends.empty() && index.nPapers() == store.nKnownPapers()) {
+    return index;
+  }
+
+  struct Entry {
+    KeywordStore::PaperId id;
+    uint16_t year;
+    uint32_t citations;
+  };
+  auto databases = getDatabases();
+  std::vector<std::vector<Entry>> partial(databases.size());
+  forEachDatabase(databases, [&](size_t i, SQLite::Database& database) {
+    try {
+      SQLite::Statement query(database,
+                              "SELECT doi, year, number FROM citations");
       while (query.executeStep()) {
-        std::string keyword = query.getColumn(0).getString();
-        std::string doi = query.getColumn(1).getString();
-        word_to_kqr[keyword]._type.insert(KeywordType::SubjectArea);
-        if (taken_doi_keyword.count({doi, keyword})) {
+        KeywordStore::PaperId id =
+            store.findPaper(query.getColumn(0).getString());
+        if (id != KeywordStore::npos) {
+          partial[i].push_back(
+              {id, static_cast<uint16_t>(query.getColumn(1).getInt()),
+               static_cast<uint32_t>(query.getColumn(2).getInt())});
+        }
+      }
+    } catch (const std::exception& e) {
+      std::cerr << "Exception: " << e.what() << std::endl;
+    }
+  });
+
+  // counting sort by paper
+  index.ends.assign(store.nKnownPapers() + 1, 0);
+  for (const auto& entries : partial) {
+    for (const Entry& entry : entries) {
+      index.ends[entry.id + 1]++;
+    }
+  }
+  for (size_t id = 0; id < store.nKnownPapers(); id++) {
+    index.ends[id + 1] += index.ends[id];
+  }
+  index.yearCitations.resize(index.ends.back());
+  std::vector<uint64_t> next(index.ends.begin(), index.ends.end() - 1);
+  for (const auto& entries : partial) {
+    for (const Entry& entry : entries) {
+      index.yearCitations[next[entry.id]++] = {entry.year, entry.citations};
+    }
+  }
+  return index;
+}
+
+bool evaluateKeywordExpression(const std::string& expression,
+                               KeywordStore& result) {
+  KeywordExpression parsed;
+  if (!parsed.parse(expression)) {
+    messageWarning("Invalid keyword expression: " + expression + " (" +
+                   parsed.error() + ")");
+    return false;
+  }
+  KeywordStore& store = getKeywordStore();
+
+  // a term is a stored keyword, e.g. a union, or the canonical keyword of a
+  // variant; an unknown term has no papers
+  std::vector<KeywordStore::Row> terms;
+  std::vector<KeywordStore::Row> termRows;
+  for (const std::string& term : parsed.terms()) {
+    KeywordStore::Row termRow = store.find(term);
+    if (termRow == KeywordStore::npos) {
+      termRow = store.find(getCanonicalizer().canonical(term));
+    }
+    if (termRow != KeywordStore::npos) {
+      loadKeywordDetail(termRow);
+      terms.push_back(termRow);
+    }
+    termRows.push_back(termRow);
+  }
+  static const PaperSet noPapers;
+  std::vector<const PaperSet*> termPapers;
+  for (KeywordStore::Row termRow : termRows) {
+    termPapers.push_back(termRow == KeywordStore::npos ? &noPapers
+                                                       : &store.papers(termRow));
+  }
+  PaperSet papers = parsed.evaluate(termPapers, store.nKnownPapers());
+
+  // citations of the matching papers, as summarizeKeywords
+  const PaperCitationYears& index = getPaperCitationYears(store);
+  std::map<size_t, size_t> yearToCitations;
+  std::map<size_t, size_t> yearToIFCitations;
+  papers.forEach([&](KeywordStore::PaperId id) {
+    size_t paperYear = store.paperYear(id);
+    for (uint64_t i = index.ends[id]; i < index.ends[id + 1]; i++) {
+      auto [year, citations] = index.yearCitations[i];
+      yearToCitations[year] += citations;
+      if (year == paperYear + 1 || year == paperYear + 2) {
+        yearToIFCitations[year] += citations;
+      }
+    }
+  });
+
+  result = store.paperSetStore(expression, papers, terms, yearToCitations,
+                               yearToIFCitations, getCurrentYear() - 1);
+  return true;
+}
+
+// Statistics of the keywords of some papers, see keywordsOfPapers
+static std::vector<KeywordQueryResult> keywordsOf(
+    const std::vector<const DBPayload*>& payloads) {
+  std::unordered_map<std::string, KeywordQueryResult> word_to_kqr;
+  for (const DBPayload* paper : payloads) {
+    const DBPayload& payload = *paper;
+    int pubYear = payload.year;
+    // same rows as the keyword tables, see loadKeywordRows
+    for (const auto& [keywords, type] :
+         {std::make_pair(&payload.author_keywords, KeywordType::AuthorKeyword),
+          std::make_pair(&payload.index_terms, KeywordType::IndexTerm),
+          std::make_pair(&payload.areas, KeywordType::SubjectArea)}) {
+      for (const auto& keyword : *keywords) {
+        auto& kqr = word_to_kqr[keyword];
+        kqr._word = keyword;
+        kqr._type.insert(type);
+        if (!kqr._papers.insert(payload.doi).second) {
           continue;
-        } else {
-          taken_doi_keyword.insert({doi, keyword});
         }
-        size_t pubYear = query.getColumn(2).getInt();
-        size_t totalCitations = query.getColumn(3).getInt();
-
-        // Query for citations associated with the DOI
-        SQLite::Statement query_citations(
-            db, "SELECT year, number FROM citations WHERE doi = ?");
-        query_citations.bind(1, doi);
-        while (query_citations.executeStep()) {
-          size_t year = query_citations.getColumn(0).getInt();
-          size_t citations = query_citations.getColumn(1).getInt();
-          word_to_kqr[keyword]._yearToCitations[year] += citations;
+
+        for (const auto& [year, citations] : payload.citations) {
+          kqr._yearToCitations[year] += citations;
           if (year == pubYear + 1 || year == pubYear + 2) {
-            word_to_kqr[keyword]
-                ._yearToCitationInYearOfPapersPublishedThePreviousTwoYears
-                    [year] += citations;
+            kqr._yearToCitationInYearOfPapersPublishedThePreviousTwoYears
+                [year] += citations;
           }
         }
-        word_to_kqr[keyword]._totalCitations += totalCitations;
-        word_to_kqr[keyword]._yearToPapers[pubYear].insert(doi);
-        word_to_kqr[keyword]._papers.insert(doi);
-        word_to_kqr[keyword]._word = keyword;
+        kqr._totalCitations += payload.total_citations;
+        kqr._paperCitations.emplace(payload.doi, payload.total_citations);
+        kqr._yearToPapers[pubYear].insert(payload.doi);
       }
     }
-  } catch (const std::exception& e) {
-    std::cerr << "Exception: " << e.what() << std::endl;
   }
 
-  // Convert the unordered_map to a vector of pairs
   std::vector<KeywordQueryResult> ret;
-  for (const auto& entry : word_to_kqr) {
-    ret.push_back(entry.second);
+  ret.reserve(word_to_kqr.size());
+  for (auto& entry : word_to_kqr) {
+    ret.push_back(std::move(entry.second));
   }
-
   return ret;
 }
 
-// Function to filter sentences based on a keyword
-std::vector<KeywordQueryResult> filterKeywordsRegex(
-    const std::string& keywordRegex,
-    const std::vector<KeywordQueryResult>& kqr_vec) {
-  std::vector<KeywordQueryResult> filtered_kqr_vec;
+KeywordDelta keywordsOfPapers(const std::vector<DBPayload>& payloads) {
+  std::vector<const DBPayload*> all;
+  std::map<std::string, std::vector<const DBPayload*>> venue_to_payloads;
+  for (const auto& payload : payloads) {
+    all.push_back(&payload);
+    if (!payload.venue.empty()) {
+      venue_to_payloads[toLower(payload.venue)].push_back(&payload);
+    }
+  }
+  KeywordDelta delta;
+  delta.keywords = keywordsOf(all);
+  for (const auto& [venue, venuePayloads] : venue_to_payloads) {
+    delta.venueKeywords[venue] = keywordsOf(venuePayloads);
+  }
+  return delta;
+}
 
+// Adds the keywords of new papers to a store with their z-scores and trends,
+// the rows of the results in order; none if the store already counts them
+static std::vector<KeywordStore::Row> mergeIntoStore(
+    KeywordStore& store, const std::vector<KeywordQueryResult>& delta) {
+  // the papers of a batch are committed together: if one is known, the store
+  // was computed after the batch and already counts it
+  for (const auto& kqr : delta) {
+    if (!kqr._papers.empty()) {
+      if (store.knowsPaper(*kqr._papers.begin())) {
+        return {};
+      }
+      break;
+    }
+  }
+
+  size_t refYear = getCurrentYear() - 1;
+  std::vector<KeywordStore::Row> rows;
+  rows.reserve(delta.size());
+  for (const auto& kqr : delta) {
+    KeywordStore::Row row = store.add(kqr);
+    store.computeZScore(row, refYear);
+    rows.push_back(row);
+  }
+  // only the rows of the batch change, the shares of the others follow the
+  // new sum of the citations
+  store.updateTrends(rows, refYear);
+  return rows;
+}
+
+void mergeIntoKeywordStore(const KeywordDelta& delta) {
+  if (delta.keywords.empty()) {
+    return;
+  }
+  // the slices of the institutions and countries are aggregated again with
+  // the new papers, the new papers of a venue are added to its slice
+  for (auto it = slices.begin(); it != slices.end();) {
+    it = it->first.first == SliceDimension::Venue ? std::next(it)
+                                                  : slices.erase(it);
+  }
+  if (venueSlicesAggregated) {
+    for (const auto& [venue, keywords] : delta.venueKeywords) {
+      mergeIntoStore(slices[{SliceDimension::Venue, venue}], keywords);
+    }
+  }
+
+  // not computed yet, the new papers are read when it is
+  if (all_words.empty()) {
+    return;
+  }
+  std::vector<KeywordStore::Row> rows =
+      mergeIntoStore(all_words, delta.keywords);
+  // keywords of each new paper, for the co-occurrences if already built
+  if (rows.empty() || !cooccurrence.isBuilt()) {
+    return;
+  }
+  std::unordered_map<std::string, std::vector<KeywordStore::Row>>
+      paper_to_rows;
+  for (size_t i = 0; i < rows.size(); i++) {
+    for (const auto& doi : delta.keywords[i]._papers) {
+      paper_to_rows[doi].push_back(rows[i]);
+    }
+  }
+  for (auto& [doi, paperRows] : paper_to_rows) {
+    cooccurrence.addPaper(std::move(paperRows));
+  }
+}
+
+// A (paper, keyword) pair, as ids of the store
+using PaperKeyword = std::pair<KeywordStore::PaperId, KeywordStore::Row>;
+
+// Pairs of the keyword tables
+static std::vector<PaperKeyword> loadKeywordPapers(
+    SQLite::Database& database, const KeywordStore& store) {
+  std::vector<PaperKeyword> pairs;
   try {
-    std::regex reg(keywordRegex);
-    for (const auto& kqr : kqr_vec) {
-      if (std::regex_search(kqr._word, reg)) {
-        filtered_kqr_vec.push_back(kqr);
+    for (const auto& [table, column] :
+         {std::make_pair("author_keyword_paper", "author_keyword"),
+          std::make_pair("index_term_paper", "index_term"),
+          std::make_pair("area_paper", "area")}) {
+      SQLite::Statement query(database, std::string("SELECT ") + column +
+                                            ", doi FROM " + table);
+      while (query.executeStep()) {
+        KeywordStore::Row row = store.find(query.getColumn(0).getString());
+        KeywordStore::PaperId paper =
+            store.findPaper(query.getColumn(1).getString());
+        if (row != KeywordStore::npos && paper != KeywordStore::npos) {
+          pairs.emplace_back(paper, row);
+        }
       }
     }
-  } catch (const std::regex_error& e) {
-    messageWarning("Invalid regex: " + keywordRegex);
+  } catch (const std::exception& e) {
+    std::cerr << "Exception: " << e.what() << std::endl;
+  }
+  return pairs;
+}
+
+const KeywordCooccurrence& getKeywordCooccurrence() {
+  if (!cooccurrence.isBuilt()) {
+    const KeywordStore& store = getKeywordStore();
+    auto databases = getDatabases();
+    std::vector<std::vector<PaperKeyword>> partial(databases.size());
+    forEachDatabase(databases, [&](size_t i, SQLite::Database& database) {
+      partial[i] = loadKeywordPapers(database, store);
+    });
+    std::vector<PaperKeyword> pairs;
+    for (auto& part : partial) {
+      pairs.insert(pairs.end(), part.begin(), part.end());
+      std::vector<PaperKeyword>().swap(part);
+    }
+    cooccurrence.build(std::move(pairs), store.size());
+  }
+  return cooccurrence;
+}
+
+std::vector<KeywordCooccurrence::Entry> getRelatedKeywords(
+    KeywordStore::Row row, size_t n) {
+  return getKeywordCooccurrence().related(row, n, getKeywordStore());
+}
+
+size_t countSharedPapers(KeywordStore::Row a, KeywordStore::Row b) {
+  return getKeywordCooccurrence().sharedPapers(a, b);
+}
+
+const KeywordBursts& getKeywordBursts() {
+  static KeywordBursts bursts;
+  KeywordStore& store = getKeywordStore();
+  if (bursts.storeVersion() != store.version()) {
+    bursts.compute(store, getCurrentYear() - 1);
   }
+  return bursts;
+}
 
-  return filtered_kqr_vec;
+void printBurstingKeywords(size_t sinceYear) {
+  const KeywordBursts& bursts = getKeywordBursts();
+  const KeywordStore& store = getKeywordStore();
+  std::cout << "word\tseries\tfrom_year\tto_year\tintensity\n";
+  for (auto series : {KeywordBursts::NewPapers, KeywordBursts::Citations}) {
+    for (const auto& burst : bursts.since(sinceYear, series, store)) {
+      std::cout << store.word(burst.row) << "\t" << toString(series) << "\t"
+                << burst.from << "\t" << burst.to << "\t" << burst.intensity
+                << "\n";
+    }
+  }
 }
 
-void addZScore(KeywordQueryResult& result) {
-  if (result._yearToCitations.size() < 2) {
-    // Not enough data points to calculate Z-score
-    result._zScore = 0;
+void printKeywordExpression(const std::string& expression) {
+  KeywordStore store;
+  if (!evaluateKeywordExpression(expression, store)) {
     return;
   }
+  KeywordStore::Row row = 0;
+  std::cout << "year\tnew_papers\tcitations\timpact_factor\n";
+  for (size_t year = store.firstYear(); year <= store.lastYear(); year++) {
+    std::cout << year << "\t" << store.newPapers(row, year) << "\t"
+              << store.citations(row, year) << "\t"
+              << store.impactFactor(row, year) << "\n";
+  }
+  std::cout << "papers\t" << store.nPapers(row) << "\ncitations\t"
+            << store.totalCitations(row) << "\nh_index\t" << store.hIndex(row)
+            << "\n";
+}
 
-  std::vector<size_t> citations;
-  for (const auto& [year, count] : result._yearToCitations) {
-    citations.push_back(count);
+void benchmarkKeywordPasses() {
+  size_t refYear = getCurrentYear() - 1;
+  std::cout << "pass\tms\n";
+  auto time = [](const std::string& pass, auto run) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << pass << "\t" << elapsed.count() << "\n";
+  };
+
+  // a store of its own, the cached one may come from the snapshot
+  KeywordStore store;
+  time("aggregate summaries", [&] { loadKeywordSummaries(store); });
+  time("z-scores", [&] { store.computeZScores(refYear); });
+  time("trends", [&] { store.computeTrends(refYear); });
+  time("cached store", [] { getKeywordStore(); });
+  time("detail of all keywords", [] { loadAllKeywordDetails(); });
+  KeywordBursts bursts;
+  time("bursts", [&] { bursts.compute(getKeywordStore(), refYear); });
+  time("co-occurrences", [] { getKeywordCooccurrence(); });
+
+  std::cout << "keywords\t" << store.nKeywords() << "\npapers\t"
+            << store.nKnownPapers() << "\nyears\t" << store.nYears()
+            << "\nbursts\t" << bursts.bursts().size() << "\n";
+}
+
+namespace {
+// Selects the k first of the rows it is given, in an order of a store, with a
+// bounded heap
+class TopRows {
+ public:
+  TopRows(const KeywordStore& store, KeywordOrder order, bool descending,
+          size_t k, const YearRange& years)
+      : _store(store),
+        _order(order),
+        _descending(descending),
+        _k(k),
+        _years(years) {
+    _result.rows.reserve(std::min(k, store.nKeywords()));
   }
 
-  double mean = calculateMean(citations);
-  double stdDev = calculateStandardDeviation(citations, mean);
+  void add(KeywordStore::Row row) {
+    _result.nMatches++;
+    // heap of the best k rows so far, its front is the last of them
+    std::vector<KeywordStore::Row>& top = _result.rows;
+    auto before = [this](KeywordStore::Row a, KeywordStore::Row b) {
+      return isBefore(a, b);
+    };
+    if (top.size() < _k) {
+      top.push_back(row);
+      std::push_heap(top.begin(), top.end(), before);
+    } else if (_k > 0 && isBefore(row, top.front())) {
+      std::pop_heap(top.begin(), top.end(), before);
+      top.back() = row;
+      std::push_heap(top.begin(), top.end(), before);
+    }
+  }
 
-  // Calculate Z-score for the last element
-  size_t zSCoreYear = getCurrentYear() - 1;
-  messageWarningIf(!result._yearToCitations.count(zSCoreYear),
-                   "No data "
-                   "found "
-                   "for "
-                   "year: " +
-                       std::to_string(zSCoreYear));
-  double lastYearCitations = result._yearToCitations.at(zSCoreYear);
-  double lastButOneYearCitations =
-      result._yearToCitations.count(zSCoreYear - 1)
-          ? result._yearToCitations.at(zSCoreYear - 1)
-          : lastYearCitations;
-  double avgCitations = (lastYearCitations + lastButOneYearCitations) / 2;
+  KeywordSearchResult result() {
+    std::sort_heap(_result.rows.begin(), _result.rows.end(),
+                   [this](KeywordStore::Row a, KeywordStore::Row b) {
+                     return isBefore(a, b);
+                   });
+    return std::move(_result);
+  }
 
-  if (stdDev != 0) {
-    result._zScore = (avgCitations - mean) / stdDev;
-  } else {
-    result._zScore = 0;  // Avoid division by zero
+ private:
+  double key(KeywordStore::Row row) const {
+    switch (_order) {
+      case KeywordOrder::Citations:
+        return static_cast<double>(_years.isAll()
+                                       ? _store.totalCitations(row)
+                                       : _store.citationsIn(row, _years));
+      case KeywordOrder::ZScore:
+        return _years.isAll() ? _store.zScore(row)
+                              : _store.zScoreIn(row, _years);
+      case KeywordOrder::Slope:
+        return _store.slope(row);
+      case KeywordOrder::GrowthRate:
+        return _store.growthRate(row);
+      case KeywordOrder::Acceleration:
+        return _store.acceleration(row);
+      case KeywordOrder::Share:
+        return _store.share(row);
+      case KeywordOrder::ImpactFactor:
+        return _years.isAll() ? _store.refYearImpactFactor(row)
+                              : _store.impactFactorIn(row, _years);
+      case KeywordOrder::HIndex:
+        return _store.hIndex(row);
+      case KeywordOrder::GIndex:
+        return _store.gIndex(row);
+      case KeywordOrder::MedianCitations:
+        return _store.medianCitations(row);
+      case KeywordOrder::TopDecileCitations:
+        return _store.topDecileCitations(row);
+    }
+    return 0;
+  }
+  // true if a comes before b in the results, ties by row
+  bool isBefore(KeywordStore::Row a, KeywordStore::Row b) const {
+    double keyA = key(a);
+    double keyB = key(b);
+    if (keyA != keyB) {
+      return _descending ? keyA > keyB : keyA < keyB;
+    }
+    return a < b;
   }
+
+  const KeywordStore& _store;
+  KeywordOrder _order;
+  bool _descending;
+  size_t _k;
+  YearRange _years;
+  KeywordSearchResult _result;
+};
+}  // namespace
+
+KeywordSearchResult searchKeywords(const std::string& searchString,
+                                   const std::set<KeywordType>& types,
+                                   KeywordOrder order, bool descending,
+                                   size_t k, const YearRange& years) {
+  return searchKeywords(getKeywordStore(), searchString, types, order,
+                        descending, k, years);
 }
 
-std::vector<KeywordQueryResult> searchKeywords(
-    const std::string& searchString) {
-  if (all_words.empty()) {
-    all_words = queryAllKeywords();
-    for (auto& kqr : all_words) {
-      addZScore(kqr);
+KeywordSearchResult searchKeywords(const KeywordStore& store,
+                                   const std::string& searchString,
+                                   const std::set<KeywordType>& types,
+                                   KeywordOrder order, bool descending,
+                                   size_t k, const YearRange& years) {
+  std::regex reg;
+  try {
+    reg = std::regex(searchString);
+  } catch (const std::regex_error& e) {
+    messageWarning("Invalid regex: " + searchString);
+    return KeywordSearchResult();
+  }
+
+  TopRows top(store, order, descending, k, years);
+  for (KeywordStore::Row row = 0; row < store.size(); row++) {
+    if (store.isRemoved(row) ||
+        std::none_of(types.begin(), types.end(), [&](KeywordType type) {
+          return store.hasType(row, type);
+        })) {
+      continue;
+    }
+    if (!searchString.empty() && !std::regex_search(store.word(row), reg)) {
+      continue;
+    }
+    top.add(row);
+  }
+  return top.result();
+}
+
+KeywordStore& getAuthorStore() {
+  if (all_authors.empty()) {
+    auto databases = getDatabases();
+    std::vector<std::vector<KeywordQueryResult>> partial(databases.size());
+    forEachDatabase(databases, [&](size_t i, SQLite::Database& database) {
+      KeywordRows rows = loadKeywordRows(database, "", "", authorSources);
+      partial[i] = aggregatePartitioned(rows, aggregateKeywords);
+    });
+    // the statistics of an author of several shards are summed by the store
+    for (const auto& results : partial) {
+      for (const auto& kqr : results) {
+        all_authors.add(kqr);
+      }
+    }
+    all_authors.computeZScores(getCurrentYear() - 1);
+    all_authors.computeTrends(getCurrentYear() - 1);
+  }
+  return all_authors;
+}
+
+KeywordSearchResult searchAuthors(const std::string& prefix,
+                                  KeywordOrder order, bool descending,
+                                  size_t k, const YearRange& years) {
+  const KeywordStore& store = getAuthorStore();
+
+  // lowercase names sorted, rebuilt when the store changes
+  static std::vector<std::pair<std::string, KeywordStore::Row>> names;
+  static size_t version = std::numeric_limits<size_t>::max();
+  if (version != store.version()) {
+    names.clear();
+    names.reserve(store.nKeywords());
+    for (KeywordStore::Row row = 0; row < store.size(); row++) {
+      if (!store.isRemoved(row)) {
+        names.emplace_back(toLower(store.word(row)), row);
+      }
+    }
+    std::sort(names.begin(), names.end());
+    version = store.version();
+  }
+
+  // the names starting with the prefix are contiguous
+  std::string lowerPrefix = toLower(prefix);
+  auto it = std::lower_bound(names.begin(), names.end(),
+                             std::make_pair(lowerPrefix, KeywordStore::Row(0)));
+  TopRows top(store, order, descending, k, years);
+  for (; it != names.end() &&
+         it->first.compare(0, lowerPrefix.size(), lowerPrefix) == 0;
+       ++it) {
+    top.add(it->second);
+  }
+  return top.result();
+}
+
+// Link table and name table of a dimension
+static std::pair<std::string, std::string> sliceTables(
+    SliceDimension dimension) {
+  switch (dimension) {
+    case SliceDimension::Country:
+      return {"country_paper", "country"};
+    case SliceDimension::Venue:
+      return {"venue_paper", "venue"};
+    default:
+      return {"institution_paper", "institution"};
+  }
+}
+
+// Aggregates the slices of all the venues in one pass over the keyword rows:
+// a paper has one venue, so its rows are partitioned by venue and each
+// partition is aggregated as a slice. Switching venues is then a lookup
+static void aggregateVenueSlices() {
+  // the papers of a batch not merged yet are added by mergeIntoKeywordStore
+  const KeywordStore& store = getKeywordStore();
+  auto databases = getDatabases();
+  std::vector<std::map<std::string, std::vector<KeywordQueryResult>>> partial(
+      databases.size());
+  forEachDatabase(databases, [&](size_t i, SQLite::Database& database) {
+    KeywordRows rows = loadKeywordRows(
+        database, " WHERE paper.doi IN (SELECT doi FROM venue_paper)");
+    removeUnknownPapers(rows, store);
+    std::unordered_map<std::string, std::string> doi_to_venue;
+    try {
+      SQLite::Statement query(database,
+                              "SELECT venue_paper.doi, venue.name FROM "
+                              "venue_paper JOIN venue ON venue.id = "
+                              "venue_paper.venue_id");
+      while (query.executeStep()) {
+        doi_to_venue.emplace(query.getColumn(0).getString(),
+                             toLower(query.getColumn(1).getString()));
+      }
+    } catch (const std::exception& e) {
+      std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    std::map<std::string, std::vector<KeywordRow>> venue_to_rows;
+    for (auto& row : rows.rows) {
+      auto it = doi_to_venue.find(rows.papers[row.paper].doi);
+      if (it != doi_to_venue.end()) {
+        venue_to_rows[it->second].push_back(std::move(row));
+      }
+    }
+    for (const auto& [venue, venueRows] : venue_to_rows) {
+      partial[i][venue] = aggregateKeywords(venueRows, rows.papers);
+    }
+  });
+
+  for (const auto& venues : partial) {
+    for (const auto& [venue, results] : venues) {
+      KeywordStore& slice = slices[{SliceDimension::Venue, venue}];
+      for (const auto& kqr : results) {
+        slice.add(kqr);
+      }
+    }
+  }
+  for (auto& [key, slice] : slices) {
+    if (key.first == SliceDimension::Venue) {
+      slice.computeZScores(getCurrentYear() - 1);
+      slice.computeTrends(getCurrentYear() - 1);
+    }
+  }
+  venueSlicesAggregated = true;
+}
+
+const KeywordStore& getKeywordSlice(SliceDimension dimension,
+                                    const std::string& name) {
+  auto key = std::make_pair(dimension, toLower(name));
+  if (dimension == SliceDimension::Venue) {
+    if (!venueSlicesAggregated) {
+      aggregateVenueSlices();
     }
+    // an unknown venue is an empty slice, not cached
+    static const KeywordStore empty;
+    auto it = slices.find(key);
+    return it == slices.end() ? empty : it->second;
   }
+  auto it = slices.find(key);
+  if (it != slices.end()) {
+    return it->second;
+  }
+
+  // not structured bindings, they are captured below
+  std::string link, table;
+  std::tie(link, table) = sliceTables(dimension);
+  // the papers counted by the cached store only, as the venue slices
+  const KeywordStore& store = getKeywordStore();
+  auto databases = getDatabases();
+  std::vector<std::vector<KeywordQueryResult>> partial(databases.size());
+  forEachDatabase(databases, [&](size_t i, SQLite::Database& database) {
+    // the ids are local to each database; an institution may have one per
+    // country
+    std::string ids;
+    try {
+      SQLite::Statement query(database,
+                              "SELECT id FROM " + table + " WHERE name = ?");
+      query.bind(1, name);
+      while (query.executeStep()) {
+        ids += (ids.empty() ? "" : ", ") + query.getColumn(0).getString();
+      }
+    } catch (const std::exception& e) {
+      std::cerr << "Exception: " << e.what() << std::endl;
+    }
+    if (!ids.empty()) {
+      std::string filter = " WHERE paper.doi IN (SELECT doi FROM " + link +
+                           " WHERE " + table + "_id IN (" + ids + "))";
+      partial[i] = queryKeywords(database, filter, &store);
+    }
+  });
 
-  return filterKeywordsRegex(searchString, all_words);
+  KeywordStore& slice = slices[key];
+  for (const auto& results : partial) {
+    for (const auto& kqr : results) {
+      slice.add(kqr);
+    }
+  }
+  slice.computeZScores(getCurrentYear() - 1);
+  slice.computeTrends(getCurrentYear() - 1);
+  return slice;
+}
+
+std::vector<std::pair<std::string, size_t>> getSliceNames(
+    SliceDimension dimension) {
+  auto [link, table] = sliceTables(dimension);
+  // the same name in several databases (or countries) is summed
+  std::map<std::string, std::pair<std::string, size_t>> lower_to_name;
+  for (auto* database : getDatabases()) {
+    try {
+      SQLite::Statement query(
+          *database, "SELECT " + table + ".name, count(*) FROM " + link +
+                         " JOIN " + table + " ON " + table + ".id = " + link +
+                         "." + table + "_id GROUP BY " + table + ".id");
+      while (query.executeStep()) {
+        std::string name = query.getColumn(0).getString();
+        auto& entry = lower_to_name[toLower(name)];
+        if (entry.first.empty()) {
+          entry.first = name;
+        }
+        entry.second += query.getColumn(1).getInt64();
+      }
+    } catch (const std::exception& e) {
+      std::cerr << "Exception: " << e.what() << std::endl;
+    }
+  }
+  std::vector<std::pair<std::string, size_t>> ret;
+  ret.reserve(lower_to_name.size());
+  for (auto& [lower, entry] : lower_to_name) {
+    ret.push_back(std::move(entry));
+  }
+  std::stable_sort(ret.begin(), ret.end(), [](const auto& a, const auto& b) {
+    return a.second > b.second;
+  });
+  return ret;
 }
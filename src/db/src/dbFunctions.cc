@@ -0,0 +1,143 @@
+#include "dbFunctions.hh"
+
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <sqlite3.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_set>
+
+#include "dbUtils.hh"
+
+namespace {
+
+struct ZScoreState {
+  std::map<size_t, size_t> yearToCitations;
+  size_t refYear = getCurrentYear() - 1;
+};
+
+struct ImpactFactorState {
+  // the year of the first row, -1 before it
+  int64_t year = -1;
+  size_t citations = 0;
+  std::unordered_set<std::string> papersOneYearBefore;
+  std::unordered_set<std::string> papersTwoYearsBefore;
+};
+
+// The aggregate context only holds a pointer to the C++ state, which is
+// allocated on the first step and released by the final callback
+template <typename State>
+State* getState(sqlite3_context* ctx, bool create) {
+  auto state = static_cast<State**>(
+      sqlite3_aggregate_context(ctx, create ? sizeof(State*) : 0));
+  if (state == nullptr) {
+    return nullptr;
+  }
+  if (*state == nullptr && create) {
+    *state = new State();
+  }
+  return *state;
+}
+
+template <typename State>
+State* releaseState(sqlite3_context* ctx) {
+  auto state = static_cast<State**>(sqlite3_aggregate_context(ctx, 0));
+  return state ? *state : nullptr;
+}
+
+void zScoreStep(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+  ZScoreState* state = getState<ZScoreState>(ctx, true);
+  if (state == nullptr) {
+    sqlite3_result_error_nomem(ctx);
+    return;
+  }
+  if (argc == 3 && sqlite3_value_type(argv[2]) != SQLITE_NULL) {
+    state->refYear = sqlite3_value_int64(argv[2]);
+  }
+  if (sqlite3_value_type(argv[0]) == SQLITE_NULL ||
+      sqlite3_value_type(argv[1]) == SQLITE_NULL) {
+    return;
+  }
+  state->yearToCitations[sqlite3_value_int64(argv[0])] +=
+      sqlite3_value_int64(argv[1]);
+}
+
+void zScoreFinal(sqlite3_context* ctx) {
+  ZScoreState* state = releaseState<ZScoreState>(ctx);
+  if (state == nullptr) {
+    sqlite3_result_double(ctx, 0);
+    return;
+  }
+  sqlite3_result_double(ctx,
+                        computeZScore(state->yearToCitations, state->refYear));
+  delete state;
+}
+
+void impactFactorStep(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+  ImpactFactorState* state = getState<ImpactFactorState>(ctx, true);
+  if (state == nullptr) {
+    sqlite3_result_error_nomem(ctx);
+    return;
+  }
+  if (sqlite3_value_type(argv[0]) == SQLITE_NULL ||
+      sqlite3_value_type(argv[1]) == SQLITE_NULL) {
+    return;
+  }
+  // the year is the same for all the rows of a group
+  int64_t year = sqlite3_value_int64(argv[0]);
+  if (year < 0) {
+    sqlite3_result_error(ctx, "circus_impact_factor: negative year", -1);
+    return;
+  }
+  if (state->year == -1) {
+    state->year = year;
+  } else if (year != state->year) {
+    sqlite3_result_error(
+        ctx, "circus_impact_factor: the year differs between the rows", -1);
+    return;
+  }
+  int64_t pubYear = sqlite3_value_int64(argv[1]);
+  if (pubYear + 1 != state->year && pubYear + 2 != state->year) {
+    return;
+  }
+
+  if (sqlite3_value_type(argv[2]) != SQLITE_NULL) {
+    std::string doi =
+        reinterpret_cast<const char*>(sqlite3_value_text(argv[2]));
+    if (pubYear + 1 == state->year) {
+      state->papersOneYearBefore.insert(doi);
+    } else {
+      state->papersTwoYearsBefore.insert(doi);
+    }
+  }
+  if (sqlite3_value_type(argv[3]) != SQLITE_NULL &&
+      sqlite3_value_type(argv[4]) != SQLITE_NULL &&
+      sqlite3_value_int64(argv[3]) == state->year) {
+    state->citations += sqlite3_value_int64(argv[4]);
+  }
+}
+
+void impactFactorFinal(sqlite3_context* ctx) {
+  ImpactFactorState* state = releaseState<ImpactFactorState>(ctx);
+  if (state == nullptr) {
+    sqlite3_result_double(ctx, 0);
+    return;
+  }
+  sqlite3_result_double(ctx, computeImpactFactor(
+                                 state->citations,
+                                 state->papersOneYearBefore.size(),
+                                 state->papersTwoYearsBefore.size()));
+  delete state;
+}
+
+}  // namespace
+
+void registerCircusFunctions(SQLite::Database& database) {
+  database.createFunction("circus_zscore", 2, true, nullptr, nullptr,
+                          zScoreStep, zScoreFinal);
+  database.createFunction("circus_zscore", 3, true, nullptr, nullptr,
+                          zScoreStep, zScoreFinal);
+  database.createFunction("circus_impact_factor", 5, true, nullptr, nullptr,
+                          impactFactorStep, impactFactorFinal);
+}
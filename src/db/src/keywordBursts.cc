@@ -0,0 +1,187 @@
+#include "keywordBursts.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+// Cost of emitting r of d events at a rate, without the binomial coefficient
+// that is the same in both states; the logarithms are taken once per series
+struct Emission {
+  double logRate;
+  double logMiss;
+
+  explicit Emission(double rate)
+      : logRate(std::log(rate)), logMiss(std::log1p(-rate)) {}
+  double cost(uint64_t r, uint64_t d) const {
+    return -(r * logRate + (d - r) * logMiss);
+  }
+};
+
+// Buffers of the detection, reused by the series of a block
+struct Scratch {
+  std::vector<uint8_t> fromBurst;
+  std::vector<uint8_t> inBurst;
+  std::vector<double> saved;
+};
+}  // namespace
+
+// Appends the bursts of one series of n years, values[t] of totals[t]
+static void detectBursts(const uint32_t* values, const uint64_t* totals,
+                         size_t n, size_t firstYear,
+                         KeywordBursts::Row row,
+                         KeywordBursts::Series series, Scratch& scratch,
+                         std::vector<KeywordBursts::Burst>& bursts) {
+  uint64_t sum = 0;
+  uint64_t total = 0;
+  for (size_t t = 0; t < n; t++) {
+    sum += values[t];
+    total += totals[t];
+  }
+  if (sum == 0 || total == 0) {
+    return;
+  }
+  double p0 = static_cast<double>(sum) / total;
+  double p1 = std::min(KeywordBursts::rateRatio * p0, 1 - 1e-9);
+  if (p1 <= p0) {
+    return;
+  }
+  double up = KeywordBursts::transitionCost * std::log(n);
+  Emission baseRate(p0);
+  Emission burstRate(p1);
+
+  // Viterbi over the two states; fromBurst[2 * t + state] tells whether the
+  // cheapest path to state at t comes from the burst state at t - 1
+  std::vector<uint8_t>& fromBurst = scratch.fromBurst;
+  std::vector<double>& saved = scratch.saved;
+  fromBurst.resize(2 * n);
+  saved.resize(n);
+  // the series starts in the base state
+  double base = 0;
+  double burst = std::numeric_limits<double>::infinity();
+  for (size_t t = 0; t < n; t++) {
+    double cost0 = baseRate.cost(values[t], totals[t]);
+    double cost1 = burstRate.cost(values[t], totals[t]);
+    saved[t] = cost0 - cost1;
+    // leaving the burst state is free
+    fromBurst[2 * t] = burst < base;
+    fromBurst[2 * t + 1] = burst <= base + up;
+    double nextBase = std::min(base, burst) + cost0;
+    double nextBurst = std::min(base + up, burst) + cost1;
+    base = nextBase;
+    burst = nextBurst;
+  }
+
+  // back from the cheapest final state
+  std::vector<uint8_t>& inBurst = scratch.inBurst;
+  inBurst.resize(n);
+  bool state = burst < base;
+  for (size_t t = n; t-- > 0;) {
+    inBurst[t] = state;
+    state = fromBurst[2 * t + state];
+  }
+  for (size_t t = 0; t < n;) {
+    if (!inBurst[t]) {
+      t++;
+      continue;
+    }
+    size_t end = t;
+    double intensity = 0;
+    while (end < n && inBurst[end]) {
+      intensity += saved[end++];
+    }
+    bursts.push_back({row, series, static_cast<uint16_t>(firstYear + t),
+                      static_cast<uint16_t>(firstYear + end - 1), intensity});
+    t = end;
+  }
+}
+
+void KeywordBursts::compute(const KeywordStore& store, size_t refYear) {
+  _bursts.clear();
+  _storeVersion = store.version();
+  if (store.nYears() == 0 || refYear < store.firstYear()) {
+    return;
+  }
+  size_t firstYear = store.firstYear();
+  size_t n = std::min(refYear, store.lastYear()) - firstYear + 1;
+
+  // events of the corpus per year: the papers known by the store, and the
+  // citations summed over the keywords
+  std::vector<uint64_t> papers(n, 0);
+  std::vector<uint64_t> citations(n, 0);
+  for (KeywordStore::PaperId id = 0; id < store.nKnownPapers(); id++) {
+    size_t year = store.paperYear(id);
+    if (year >= firstYear && year < firstYear + n) {
+      papers[year - firstYear]++;
+    }
+  }
+  for (Row row = 0; row < store.size(); row++) {
+    if (!store.isRemoved(row)) {
+      const uint32_t* values = store.citationsRow(row);
+      for (size_t t = 0; t < n; t++) {
+        citations[t] += values[t];
+      }
+    }
+  }
+
+  // rows are independent, the store is split into contiguous blocks of rows
+  // computed on their own threads, concatenated in order
+  constexpr size_t minRowsPerBlock = 4096;
+  size_t nBlocks = std::max<size_t>(
+      1, std::min<size_t>(std::thread::hardware_concurrency(),
+                          store.size() / minRowsPerBlock));
+  size_t rowsPerBlock = (store.size() + nBlocks - 1) / nBlocks;
+  std::vector<std::vector<Burst>> blockBursts(nBlocks);
+  auto computeBlock = [&](size_t block) {
+    Scratch scratch;
+    Row end = std::min(store.size(), (block + 1) * rowsPerBlock);
+    for (Row row = block * rowsPerBlock; row < end; row++) {
+      if (store.isRemoved(row)) {
+        continue;
+      }
+      detectBursts(store.newPapersRow(row), papers.data(), n, firstYear, row,
+                   NewPapers, scratch, blockBursts[block]);
+      detectBursts(store.citationsRow(row), citations.data(), n, firstYear,
+                   row, Citations, scratch, blockBursts[block]);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t block = 1; block < nBlocks; block++) {
+    workers.emplace_back(computeBlock, block);
+  }
+  computeBlock(0);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  for (auto& bursts : blockBursts) {
+    _bursts.insert(_bursts.end(), bursts.begin(), bursts.end());
+  }
+}
+
+std::vector<KeywordBursts::Burst> KeywordBursts::since(
+    size_t sinceYear, Series series, const KeywordStore& store) const {
+  std::unordered_map<Row, Burst> strongest;
+  for (const Burst& burst : _bursts) {
+    if (burst.series != series || burst.from < sinceYear ||
+        burst.row >= store.size() || store.isRemoved(burst.row)) {
+      continue;
+    }
+    auto [it, inserted] = strongest.emplace(burst.row, burst);
+    if (!inserted && burst.intensity > it->second.intensity) {
+      it->second = burst;
+    }
+  }
+  std::vector<Burst> ret;
+  ret.reserve(strongest.size());
+  for (const auto& [row, burst] : strongest) {
+    ret.push_back(burst);
+  }
+  std::sort(ret.begin(), ret.end(), [](const Burst& a, const Burst& b) {
+    return a.intensity != b.intensity ? a.intensity > b.intensity
+                                      : a.row < b.row;
+  });
+  return ret;
+}
@@ -0,0 +1,136 @@
+#include "keywordCanonicalizer.hh"
+
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "keywordSnapshot.hh"
+
+static bool endsWith(const std::string& word, const std::string& suffix) {
+  return word.size() >= suffix.size() &&
+         word.compare(word.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Whether a word has one of the vowels
+static bool hasVowel(const std::string& word) {
+  return word.find_first_of("aeiou") != std::string::npos;
+}
+
+// Singular of a plural word, unchanged if not a plural
+static std::string stem(const std::string& word) {
+  // words and acronyms ending with an s that is not a plural
+  static const std::unordered_set<std::string> invariant = {
+      "series", "species", "news", "lens", "bias", "gas",  "chaos",
+      "corpus", "cmos",    "nmos", "pmos", "mems", "dvfs", "flops", "rtos",
+      "mips",   "iops",    "tops", "plus", "thus"};
+  // plurals out of the suffix rules
+  static const std::unordered_map<std::string, std::string> irregular = {
+      {"analyses", "analysis"},     {"syntheses", "synthesis"},
+      {"hypotheses", "hypothesis"}, {"diagnoses", "diagnosis"},
+      {"theses", "thesis"},         {"buses", "bus"},
+      {"viruses", "virus"},         {"gases", "gas"},
+      {"biases", "bias"},           {"lenses", "lens"}};
+  if (word.size() <= 3 || invariant.count(word) ||
+      !std::isalpha(static_cast<unsigned char>(word.back()))) {
+    return word;
+  }
+  auto it = irregular.find(word);
+  if (it != irregular.end()) {
+    return it->second;
+  }
+  if (endsWith(word, "ies") && !endsWith(word, "eies") &&
+      !endsWith(word, "aies")) {
+    return word.substr(0, word.size() - 3) + "y";
+  }
+  // "es" after a sibilant: boxes, meshes, switches, but caches
+  if (endsWith(word, "sses") || endsWith(word, "xes") ||
+      endsWith(word, "shes") ||
+      (endsWith(word, "ches") && !endsWith(word, "caches"))) {
+    return word.substr(0, word.size() - 2);
+  }
+  // acronym plurals: no vowel before "us" (gpus, mcus, but focus, status),
+  // and the short "ics" (asics, but optics, physics)
+  bool acronym =
+      (endsWith(word, "us") && !hasVowel(word.substr(0, word.size() - 2))) ||
+      (endsWith(word, "ics") && word.size() <= 5);
+  if (endsWith(word, "s") && !endsWith(word, "ss") && !endsWith(word, "is") &&
+      (acronym || (!endsWith(word, "us") && !endsWith(word, "ics")))) {
+    return word.substr(0, word.size() - 1);
+  }
+  return word;
+}
+
+std::string KeywordCanonicalizer::normalize(const std::string& keyword) {
+  std::string text = keyword;
+  // a trailing acronym in parentheses repeats the words before it
+  if (!text.empty() && text.back() == ')') {
+    size_t open = text.rfind('(');
+    if (open != std::string::npos && open > 0 &&
+        text.find(' ', open) == std::string::npos) {
+      text.erase(open);
+    }
+  }
+
+  std::string folded;
+  for (size_t i = 0; i < text.size(); i++) {
+    char c = text[i];
+    bool inNumber = c == '.' && i > 0 && i + 1 < text.size() &&
+                    std::isdigit(static_cast<unsigned char>(text[i - 1])) &&
+                    std::isdigit(static_cast<unsigned char>(text[i + 1]));
+    if (c == '"' || c == '\'') {
+      continue;
+    }
+    if (c == '-' || c == '_' || c == '/' || c == '(' || c == ')' ||
+        (c == '.' && !inNumber) ||
+        std::isspace(static_cast<unsigned char>(c))) {
+      c = ' ';
+    }
+    folded += std::tolower(static_cast<unsigned char>(c));
+  }
+
+  std::string ret;
+  std::istringstream words(folded);
+  std::string word;
+  while (words >> word) {
+    ret += (ret.empty() ? "" : " ") + stem(word);
+  }
+  return ret;
+}
+
+std::string KeywordCanonicalizer::canonical(const std::string& keyword) const {
+  std::string normalized = normalize(keyword);
+  auto it = _synonyms.find(normalized);
+  return it == _synonyms.end() ? normalized : it->second;
+}
+
+bool KeywordCanonicalizer::loadSynonyms(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) {
+    return false;
+  }
+  std::string contents;
+  std::string line;
+  while (std::getline(in, line)) {
+    contents += line + "\n";
+    line = line.substr(0, line.find('#'));
+    std::vector<std::string> terms;
+    std::istringstream group(line);
+    std::string term;
+    while (std::getline(group, term, ',')) {
+      term = normalize(term);
+      if (!term.empty()) {
+        terms.push_back(term);
+      }
+    }
+    for (size_t i = 1; i < terms.size(); i++) {
+      if (terms[i] != terms.front()) {
+        _synonyms[terms[i]] = terms.front();
+      }
+    }
+  }
+  _signature = KeywordSnapshot::hash(contents, _signature);
+  return true;
+}
@@ -0,0 +1,243 @@
+#include "keywordCooccurrence.hh"
+
+#include <algorithm>
+#include <thread>
+
+// decreasing count, then increasing row
+static bool before(const KeywordCooccurrence::Entry& a,
+                   const KeywordCooccurrence::Entry& b) {
+  return a.count != b.count ? a.count > b.count : a.row < b.row;
+}
+
+void KeywordCooccurrence::build(std::vector<std::pair<PaperId, Row>> pairs,
+                                size_t nRows) {
+  std::sort(pairs.begin(), pairs.end());
+  pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+  // keywords of each paper, the papers with a single keyword relate nothing
+  std::vector<uint64_t> paperOffsets = {0};
+  std::vector<Row> paperRows;
+  paperRows.reserve(pairs.size());
+  for (size_t i = 0; i < pairs.size();) {
+    size_t j = i;
+    while (j < pairs.size() && pairs[j].first == pairs[i].first) j++;
+    if (j - i > 1) {
+      for (size_t k = i; k < j; k++) {
+        paperRows.push_back(pairs[k].second);
+      }
+      paperOffsets.push_back(paperRows.size());
+    }
+    i = j;
+  }
+  pairs.clear();
+  pairs.shrink_to_fit();
+  size_t nPapers = paperOffsets.size() - 1;
+
+  // papers of each keyword, and the work of the keyword: the entries it
+  // visits
+  std::vector<uint64_t> rowOffsets(nRows + 1, 0);
+  std::vector<uint64_t> work(nRows, 0);
+  for (size_t p = 0; p < nPapers; p++) {
+    for (uint64_t k = paperOffsets[p]; k < paperOffsets[p + 1]; k++) {
+      rowOffsets[paperRows[k] + 1]++;
+      work[paperRows[k]] += paperOffsets[p + 1] - paperOffsets[p] - 1;
+    }
+  }
+  for (size_t r = 0; r < nRows; r++) {
+    rowOffsets[r + 1] += rowOffsets[r];
+  }
+  std::vector<uint32_t> rowPapers(rowOffsets[nRows]);
+  {
+    std::vector<uint64_t> next(rowOffsets.begin(), rowOffsets.end() - 1);
+    for (size_t p = 0; p < nPapers; p++) {
+      for (uint64_t k = paperOffsets[p]; k < paperOffsets[p + 1]; k++) {
+        rowPapers[next[paperRows[k]]++] = p;
+      }
+    }
+  }
+
+  // contiguous blocks of rows with about the same work
+  constexpr uint64_t minWorkPerBlock = 1 << 20;
+  uint64_t totalWork = 0;
+  for (uint64_t w : work) {
+    totalWork += w;
+  }
+  size_t nBlocks = std::max<size_t>(
+      1, std::min<size_t>(std::thread::hardware_concurrency(),
+                          totalWork / minWorkPerBlock));
+  std::vector<Row> blockBegin = {0};
+  uint64_t accumulated = 0;
+  for (Row r = 0; r < nRows && blockBegin.size() < nBlocks; r++) {
+    accumulated += work[r];
+    if (accumulated * nBlocks >= totalWork * blockBegin.size()) {
+      blockBegin.push_back(r + 1);
+    }
+  }
+  nBlocks = blockBegin.size();
+  blockBegin.push_back(nRows);
+
+  // each block counts the related keywords of a row in a dense array, and
+  // resets only the touched counters
+  std::vector<std::vector<Entry>> blockEntries(nBlocks);
+  std::vector<uint64_t> rowSizes(nRows, 0);
+  auto computeBlock = [&](size_t block) {
+    std::vector<uint32_t> counts(nRows, 0);
+    std::vector<Row> touched;
+    std::vector<Entry>& entries = blockEntries[block];
+    for (Row r = blockBegin[block]; r < blockBegin[block + 1]; r++) {
+      for (uint64_t i = rowOffsets[r]; i < rowOffsets[r + 1]; i++) {
+        uint32_t p = rowPapers[i];
+        for (uint64_t k = paperOffsets[p]; k < paperOffsets[p + 1]; k++) {
+          Row other = paperRows[k];
+          if (other != r && counts[other]++ == 0) {
+            touched.push_back(other);
+          }
+        }
+      }
+      size_t begin = entries.size();
+      for (Row other : touched) {
+        entries.push_back({other, counts[other]});
+        counts[other] = 0;
+      }
+      std::sort(entries.begin() + begin, entries.end(), before);
+      rowSizes[r] = touched.size();
+      touched.clear();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t block = 1; block < nBlocks; block++) {
+    workers.emplace_back(computeBlock, block);
+  }
+  computeBlock(0);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  _offsets.assign(nRows + 1, 0);
+  for (size_t r = 0; r < nRows; r++) {
+    _offsets[r + 1] = _offsets[r] + rowSizes[r];
+  }
+  _entries.clear();
+  _entries.reserve(_offsets[nRows]);
+  for (auto& entries : blockEntries) {
+    _entries.insert(_entries.end(), entries.begin(), entries.end());
+    std::vector<Entry>().swap(entries);
+  }
+  _delta.clear();
+  _deltaSize = 0;
+}
+
+void KeywordCooccurrence::addPaper(std::vector<Row> rows) {
+  std::sort(rows.begin(), rows.end());
+  rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+  for (Row a : rows) {
+    for (Row b : rows) {
+      if (a != b && _delta[a][b]++ == 0) {
+        _deltaSize++;
+      }
+    }
+  }
+  if (_deltaSize > std::max<size_t>(_entries.size() / 8, 1 << 16)) {
+    fold();
+  }
+}
+
+std::vector<KeywordCooccurrence::Entry> KeywordCooccurrence::merged(
+    Row row) const {
+  std::vector<Entry> entries;
+  if (row < nRows()) {
+    entries.assign(_entries.begin() + _offsets[row],
+                   _entries.begin() + _offsets[row + 1]);
+  }
+  auto it = _delta.find(row);
+  if (it == _delta.end()) {
+    return entries;
+  }
+  std::unordered_map<Row, uint32_t> added = it->second;
+  for (Entry& entry : entries) {
+    auto other = added.find(entry.row);
+    if (other != added.end()) {
+      entry.count += other->second;
+      added.erase(other);
+    }
+  }
+  for (const auto& [other, count] : added) {
+    entries.push_back({other, count});
+  }
+  std::sort(entries.begin(), entries.end(), before);
+  return entries;
+}
+
+void KeywordCooccurrence::fold() {
+  size_t n = nRows();
+  for (const auto& [row, added] : _delta) {
+    n = std::max<size_t>(n, row + 1);
+  }
+  std::vector<uint64_t> offsets(n + 1, 0);
+  std::vector<Entry> entries;
+  entries.reserve(_entries.size() + _deltaSize);
+  for (Row r = 0; r < n; r++) {
+    if (_delta.count(r)) {
+      std::vector<Entry> row = merged(r);
+      entries.insert(entries.end(), row.begin(), row.end());
+    } else if (r < nRows()) {
+      entries.insert(entries.end(), _entries.begin() + _offsets[r],
+                     _entries.begin() + _offsets[r + 1]);
+    }
+    offsets[r + 1] = entries.size();
+  }
+  _offsets.swap(offsets);
+  _entries.swap(entries);
+  _delta.clear();
+  _deltaSize = 0;
+}
+
+std::vector<KeywordCooccurrence::Entry> KeywordCooccurrence::related(
+    Row row, size_t n, const KeywordStore& store) const {
+  std::vector<Entry> ret;
+  auto take = [&](auto begin, auto end) {
+    for (auto it = begin; it != end && ret.size() < n; ++it) {
+      if (!store.isRemoved(it->row)) {
+        ret.push_back(*it);
+      }
+    }
+  };
+  if (_delta.count(row)) {
+    std::vector<Entry> entries = merged(row);
+    take(entries.begin(), entries.end());
+  } else if (row < nRows()) {
+    take(_entries.begin() + _offsets[row], _entries.begin() + _offsets[row + 1]);
+  }
+  return ret;
+}
+
+uint32_t KeywordCooccurrence::sharedPapers(Row a, Row b) const {
+  uint32_t count = 0;
+  if (a < nRows() && b < nRows()) {
+    // the entries are sorted by count, the shorter row is scanned
+    if (_offsets[b + 1] - _offsets[b] < _offsets[a + 1] - _offsets[a]) {
+      std::swap(a, b);
+    }
+    auto end = _entries.begin() + _offsets[a + 1];
+    auto it = std::find_if(_entries.begin() + _offsets[a], end,
+                           [b](const Entry& entry) { return entry.row == b; });
+    if (it != end) {
+      count = it->count;
+    }
+  }
+  auto it = _delta.find(a);
+  if (it != _delta.end()) {
+    auto other = it->second.find(b);
+    if (other != it->second.end()) {
+      count += other->second;
+    }
+  }
+  return count;
+}
+
+size_t KeywordCooccurrence::memoryUsage() const {
+  return _offsets.capacity() * sizeof(uint64_t) +
+         _entries.capacity() * sizeof(Entry) +
+         _deltaSize * (sizeof(Row) + sizeof(uint32_t) + 2 * sizeof(void*));
+}
@@ -0,0 +1,212 @@
+#include "keywordExpression.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <numeric>
+
+namespace {
+struct Token {
+  enum Kind : uint8_t { Term, And, Or, Not, Open, Close, End };
+  Kind kind;
+  std::string text;
+};
+
+// Splits an expression into terms and operators, false if a quote is not
+// closed (the tokens before it are kept)
+bool tokenize(const std::string& expression, std::vector<Token>& tokens) {
+  std::string words;
+  auto flushWords = [&]() {
+    if (!words.empty()) {
+      tokens.push_back({Token::Term, words});
+      words.clear();
+    }
+  };
+  size_t i = 0;
+  while (i < expression.size()) {
+    char c = expression[i];
+    if (std::isspace(static_cast<unsigned char>(c))) {
+      i++;
+    } else if (c == '(' || c == ')') {
+      flushWords();
+      tokens.push_back({c == '(' ? Token::Open : Token::Close, ""});
+      i++;
+    } else if (c == '"') {
+      flushWords();
+      size_t close = expression.find('"', i + 1);
+      if (close == std::string::npos) {
+        return false;
+      }
+      tokens.push_back({Token::Term, expression.substr(i + 1, close - i - 1)});
+      i = close + 1;
+    } else {
+      size_t end = i;
+      while (end < expression.size() &&
+             !std::isspace(static_cast<unsigned char>(expression[end])) &&
+             expression[end] != '(' && expression[end] != ')' &&
+             expression[end] != '"') {
+        end++;
+      }
+      std::string word = expression.substr(i, end - i);
+      i = end;
+      Token::Kind kind = word == "AND"   ? Token::And
+                         : word == "OR"  ? Token::Or
+                         : word == "NOT" ? Token::Not
+                                         : Token::Term;
+      if (kind == Token::Term) {
+        words += (words.empty() ? "" : " ") + word;
+      } else {
+        flushWords();
+        tokens.push_back({kind, ""});
+      }
+    }
+  }
+  flushWords();
+  tokens.push_back({Token::End, ""});
+  return true;
+}
+}  // namespace
+
+bool KeywordExpression::hasOperator(const std::string& text) {
+  std::vector<Token> tokens;
+  tokenize(text, tokens);
+  return std::any_of(tokens.begin(), tokens.end(), [](const Token& token) {
+    return token.kind == Token::And || token.kind == Token::Or ||
+           token.kind == Token::Not;
+  });
+}
+
+bool KeywordExpression::parse(const std::string& expression) {
+  _program.clear();
+  _terms.clear();
+  _error.clear();
+  std::vector<Token> tokens;
+  if (!tokenize(expression, tokens)) {
+    _error = "unterminated quote";
+    return false;
+  }
+
+  // recursive descent emitting the postfix program:
+  //   or    := and (OR and)*
+  //   and   := unary ((AND | AND NOT | NOT) unary)*
+  //   unary := NOT unary | '(' or ')' | term
+  size_t next = 0;
+  auto peek = [&]() { return tokens[next].kind; };
+  auto emit = [&](Op op) { _program.push_back({op, 0}); };
+  auto emitTerm = [&](const std::string& keyword) {
+    uint32_t term = 0;
+    while (term < _terms.size() && _terms[term] != keyword) {
+      term++;
+    }
+    if (term == _terms.size()) {
+      _terms.push_back(keyword);
+    }
+    _program.push_back({Term, term});
+  };
+
+  std::function<bool()> parseOr;
+  std::function<bool()> parseUnary = [&]() {
+    switch (peek()) {
+      case Token::Not:
+        next++;
+        if (!parseUnary()) {
+          return false;
+        }
+        emit(Not);
+        return true;
+      case Token::Open:
+        next++;
+        if (!parseOr()) {
+          return false;
+        }
+        if (peek() != Token::Close) {
+          _error = "missing ')'";
+          return false;
+        }
+        next++;
+        return true;
+      case Token::Term:
+        emitTerm(tokens[next++].text);
+        return true;
+      default:
+        _error = "keyword expected";
+        return false;
+    }
+  };
+  auto parseAnd = [&]() {
+    if (!parseUnary()) {
+      return false;
+    }
+    while (peek() == Token::And || peek() == Token::Not) {
+      bool negated = peek() == Token::Not;
+      next++;
+      if (!negated && peek() == Token::Not) {
+        negated = true;
+        next++;
+      }
+      if (!parseUnary()) {
+        return false;
+      }
+      emit(negated ? AndNot : And);
+    }
+    return true;
+  };
+  parseOr = [&]() {
+    if (!parseAnd()) {
+      return false;
+    }
+    while (peek() == Token::Or) {
+      next++;
+      if (!parseAnd()) {
+        return false;
+      }
+      emit(Or);
+    }
+    return true;
+  };
+
+  if (!parseOr()) {
+    _program.clear();
+    _terms.clear();
+    return false;
+  }
+  if (peek() != Token::End) {
+    _error = peek() == Token::Close ? "unexpected ')'" : "operator expected";
+    _program.clear();
+    _terms.clear();
+    return false;
+  }
+  return true;
+}
+
+PaperSet KeywordExpression::evaluate(
+    const std::vector<const PaperSet*>& termPapers, size_t nPapers) const {
+  std::vector<PaperSet> stack;
+  for (const Instruction& instruction : _program) {
+    if (instruction.op == Term) {
+      stack.push_back(*termPapers[instruction.term]);
+      continue;
+    }
+    if (instruction.op == Not) {
+      std::vector<PaperSet::Id> all(nPapers);
+      std::iota(all.begin(), all.end(), 0);
+      stack.back() = PaperSet::fromSorted(all) - stack.back();
+      continue;
+    }
+    PaperSet right = std::move(stack.back());
+    stack.pop_back();
+    PaperSet& left = stack.back();
+    switch (instruction.op) {
+      case And:
+        left = left & right;
+        break;
+      case Or:
+        left |= right;
+        break;
+      default:
+        left = left - right;
+        break;
+    }
+  }
+  return stack.empty() ? PaperSet() : std::move(stack.back());
+}
@@ -0,0 +1,324 @@
+#include "keywordSnapshot.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <type_traits>
+
+static const char magic[8] = {'C', 'I', 'R', 'C', 'S', 'N', 'A', 'P'};
+// bumped on any change of the layout
+static const uint32_t formatVersion = 3;
+static const size_t pageSize = 4096;
+
+enum Section {
+  WordOffsets,
+  WordChars,
+  Types,
+  TotalCitations,
+  ZScores,
+  CitationFrom,
+  CitationTo,
+  NPapers,
+  PaperFrom,
+  PaperTo,
+  Citations,
+  NewPapers,
+  IFCitations,
+  PaperCitationEnds,
+  PaperCitationLists,
+  DoiOffsets,
+  DoiChars,
+  PaperYears,
+  PaperCitations,
+  NSections
+};
+
+namespace {
+struct SectionInfo {
+  uint64_t offset;
+  uint64_t size;
+};
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t nSections;
+  uint64_t key;
+  uint64_t nRows;
+  uint64_t nPapers;
+  uint64_t firstYear;
+  uint64_t nYears;
+  SectionInfo sections[NSections];
+};
+
+// The bytes of a section, not owned
+struct Bytes {
+  const void* data;
+  size_t size;
+};
+
+// Strings as end offsets into the concatenated characters
+struct Strings {
+  std::vector<uint64_t> offsets;
+  std::string chars;
+
+  explicit Strings(const std::vector<std::string>& strings) {
+    offsets.reserve(strings.size());
+    for (const auto& str : strings) {
+      chars += str;
+      offsets.push_back(chars.size());
+    }
+  }
+};
+}  // namespace
+
+template <typename T>
+static Bytes bytesOf(const Column<T>& column) {
+  return {column.data(), column.size() * sizeof(T)};
+}
+
+template <typename T>
+static Bytes bytesOf(const std::vector<T>& values) {
+  return {values.data(), values.size() * sizeof(T)};
+}
+
+static size_t alignToPage(size_t offset) {
+  return (offset + pageSize - 1) / pageSize * pageSize;
+}
+
+uint64_t KeywordSnapshot::hash(const std::string& data, uint64_t seed) {
+  for (unsigned char c : data) {
+    seed = (seed ^ c) * 1099511628211ull;
+  }
+  return seed;
+}
+
+bool KeywordSnapshot::save(const KeywordStore& store, const std::string& path,
+                           uint64_t key) {
+  // the snapshot holds the content of the databases, not the keywords
+  // removed since, with the citations of the papers in their arrays
+  if (store._nRemoved > 0 || !store._pendingPaperCitations.empty() ||
+      !store._movedPaperCitations.empty()) {
+    return false;
+  }
+  Strings words(store._words);
+  Strings dois(store._paperDois);
+  Bytes sections[NSections] = {};
+  sections[WordOffsets] = bytesOf(words.offsets);
+  sections[WordChars] = {words.chars.data(), words.chars.size()};
+  sections[Types] = bytesOf(store._types);
+  sections[TotalCitations] = bytesOf(store._totalCitations);
+  sections[ZScores] = bytesOf(store._zScores);
+  sections[CitationFrom] = bytesOf(store._citationFrom);
+  sections[CitationTo] = bytesOf(store._citationTo);
+  sections[NPapers] = bytesOf(store._nPapers);
+  sections[PaperFrom] = bytesOf(store._paperFrom);
+  sections[PaperTo] = bytesOf(store._paperTo);
+  sections[Citations] = bytesOf(store._citations);
+  sections[NewPapers] = bytesOf(store._newPapers);
+  sections[IFCitations] = bytesOf(store._ifCitations);
+  sections[PaperCitationEnds] = bytesOf(store._paperCitationEnds);
+  sections[PaperCitationLists] = bytesOf(store._paperCitationLists);
+  sections[DoiOffsets] = bytesOf(dois.offsets);
+  sections[DoiChars] = {dois.chars.data(), dois.chars.size()};
+  sections[PaperYears] = bytesOf(store._paperYears);
+  sections[PaperCitations] = bytesOf(store._paperCitations);
+
+  Header header = {};
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.version = formatVersion;
+  header.nSections = NSections;
+  header.key = key;
+  header.nRows = store.size();
+  header.nPapers = store._paperDois.size();
+  header.firstYear = store._firstYear;
+  header.nYears = store._nYears;
+  size_t offset = alignToPage(sizeof(Header));
+  for (size_t i = 0; i < NSections; i++) {
+    header.sections[i] = {offset, sections[i].size};
+    offset = alignToPage(offset + sections[i].size);
+  }
+
+  // written aside and renamed, so that readers never map half a file
+  std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return false;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (size_t i = 0; i < NSections; i++) {
+      out.seekp(header.sections[i].offset);
+      out.write(static_cast<const char*>(sections[i].data), sections[i].size);
+    }
+    // the mapping covers whole pages
+    out.seekp(offset - 1);
+    out.put(0);
+    if (!out) {
+      std::remove(tmpPath.c_str());
+      return false;
+    }
+  }
+  return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+// Checks that the sections are inside the file and have the sizes of the
+// columns described by the header
+static bool isValid(const Header& header, size_t fileSize) {
+  if (header.nSections != NSections || header.nRows >= KeywordStore::npos) {
+    return false;
+  }
+  uint64_t matrixSize = header.nRows * header.nYears;
+  const uint64_t expected[NSections] = {
+      header.nRows * sizeof(uint64_t),  0,
+      header.nRows * sizeof(uint8_t),   header.nRows * sizeof(uint64_t),
+      header.nRows * sizeof(double),    header.nRows * sizeof(uint16_t),
+      header.nRows * sizeof(uint16_t),  header.nRows * sizeof(uint32_t),
+      header.nRows * sizeof(uint16_t),  header.nRows * sizeof(uint16_t),
+      matrixSize * sizeof(uint32_t),    matrixSize * sizeof(uint32_t),
+      matrixSize * sizeof(uint32_t),    header.nRows * sizeof(uint64_t),
+      0,                                header.nPapers * sizeof(uint64_t),
+      0,                                header.nPapers * sizeof(uint16_t),
+      header.nPapers * sizeof(uint32_t)};
+  for (size_t i = 0; i < NSections; i++) {
+    const SectionInfo& section = header.sections[i];
+    bool variable =
+        i == WordChars || i == DoiChars || i == PaperCitationLists;
+    if (section.offset % pageSize != 0 || section.offset > fileSize ||
+        section.size > fileSize - section.offset ||
+        (!variable && section.size != expected[i])) {
+      return false;
+    }
+  }
+  return header.sections[PaperCitationLists].size % sizeof(uint32_t) == 0;
+}
+
+// Copies strings stored as end offsets, false if the offsets are corrupted
+static bool readStrings(const uint64_t* offsets, size_t count,
+                        const char* chars, size_t charsSize,
+                        std::vector<std::string>& strings) {
+  strings.reserve(count);
+  uint64_t begin = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (offsets[i] < begin || offsets[i] > charsSize) {
+      return false;
+    }
+    strings.emplace_back(chars + begin, offsets[i] - begin);
+    begin = offsets[i];
+  }
+  return true;
+}
+
+bool KeywordSnapshot::load(KeywordStore& store, const std::string& path,
+                           uint64_t key) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+    close(fd);
+    return false;
+  }
+  size_t fileSize = st.st_size;
+  void* address = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (address == MAP_FAILED) {
+    return false;
+  }
+  // unmapped when the last column viewing it is gone
+  std::shared_ptr<const void> mapping(address, [fileSize](const void* p) {
+    munmap(const_cast<void*>(p), fileSize);
+  });
+
+  const char* base = static_cast<const char*>(address);
+  const Header& header = *reinterpret_cast<const Header*>(base);
+  if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+      header.version != formatVersion || header.key != key ||
+      !isValid(header, fileSize)) {
+    return false;
+  }
+  auto sectionData = [&](Section section) {
+    return base + header.sections[section].offset;
+  };
+  auto view = [&](auto& column, Section section, size_t size) {
+    using T = std::remove_const_t<
+        std::remove_reference_t<decltype(column[0])>>;
+    column = Column<T>::view(reinterpret_cast<const T*>(sectionData(section)),
+                             size, mapping);
+  };
+
+  KeywordStore loaded;
+  if (!readStrings(reinterpret_cast<const uint64_t*>(sectionData(WordOffsets)),
+                   header.nRows, sectionData(WordChars),
+                   header.sections[WordChars].size, loaded._words) ||
+      !readStrings(reinterpret_cast<const uint64_t*>(sectionData(DoiOffsets)),
+                   header.nPapers, sectionData(DoiChars),
+                   header.sections[DoiChars].size, loaded._paperDois)) {
+    return false;
+  }
+  for (KeywordStore::Row row = 0; row < header.nRows; row++) {
+    loaded._wordToRow.emplace(loaded._words[row], row);
+  }
+  for (KeywordStore::PaperId id = 0; id < header.nPapers; id++) {
+    loaded._paperIds.emplace(loaded._paperDois[id], id);
+  }
+
+  size_t nRows = header.nRows;
+  view(loaded._types, Types, nRows);
+  view(loaded._totalCitations, TotalCitations, nRows);
+  view(loaded._zScores, ZScores, nRows);
+  view(loaded._citationFrom, CitationFrom, nRows);
+  view(loaded._citationTo, CitationTo, nRows);
+  view(loaded._nPapers, NPapers, nRows);
+  view(loaded._paperFrom, PaperFrom, nRows);
+  view(loaded._paperTo, PaperTo, nRows);
+  view(loaded._citations, Citations, nRows * header.nYears);
+  view(loaded._newPapers, NewPapers, nRows * header.nYears);
+  view(loaded._ifCitations, IFCitations, nRows * header.nYears);
+  view(loaded._paperYears, PaperYears, header.nPapers);
+  view(loaded._paperCitations, PaperCitations, header.nPapers);
+  // the arrays of the rows end inside the section, in order
+  size_t nCitations =
+      header.sections[PaperCitationLists].size / sizeof(uint32_t);
+  view(loaded._paperCitationEnds, PaperCitationEnds, nRows);
+  view(loaded._paperCitationLists, PaperCitationLists, nCitations);
+  for (KeywordStore::Row row = 0; row < nRows; row++) {
+    uint64_t begin = row == 0 ? 0 : loaded._paperCitationEnds[row - 1];
+    if (loaded._paperCitationEnds[row] < begin ||
+        loaded._paperCitationEnds[row] > nCitations) {
+      return false;
+    }
+  }
+
+  // the detail is not in the snapshot, it is loaded on demand
+  // the trends, impact factors and prefix sums are derived, computed by the
+  // caller
+  loaded._slopes.assign(nRows, 0);
+  loaded._growthRates.assign(nRows, 0);
+  loaded._accelerations.assign(nRows, 0);
+  loaded._hIndexes.assign(nRows, 0);
+  loaded._gIndexes.assign(nRows, 0);
+  loaded._medianCitations.assign(nRows, 0);
+  loaded._topDecileCitations.assign(nRows, 0);
+  loaded._hasDetail.assign(nRows, 0);
+  loaded._removed.assign(nRows, 0);
+  loaded._papers.resize(nRows);
+  loaded._impactFactors.assign(nRows * header.nYears, 0);
+  loaded._citationSums.assign(nRows * (header.nYears + 1), 0);
+  loaded._citationSquareSums.assign(nRows * (header.nYears + 1), 0);
+  loaded._newPaperSums.assign(nRows * (header.nYears + 1), 0);
+  loaded._ifCitationSums.assign(nRows * (header.nYears + 1), 0);
+  loaded._firstYear = header.firstYear;
+  loaded._nYears = header.nYears;
+
+  loaded._version = store._version + 1;
+  store = std::move(loaded);
+  return true;
+}
@@ -0,0 +1,619 @@
+#include "keywordStatsVTab.hh"
+
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "db.hh"
+
+namespace {
+
+enum StatsColumn {
+  WordCol,
+  TypesCol,
+  TotalCitationsCol,
+  ZScoreCol,
+  PapersCol,
+  FirstYearCol,
+  LastYearCol,
+  SlopeCol,
+  GrowthRateCol,
+  AccelerationCol,
+  ShareCol,
+  ImpactFactorStatsCol,
+  HIndexCol,
+  GIndexCol,
+  MedianCitationsCol,
+  TopDecileCitationsCol,
+  // hidden, the name of the slice (slice tables only)
+  SliceCol
+};
+
+enum YearStatsColumn {
+  YearWordCol,
+  YearCol,
+  CitationsCol,
+  NewPapersCol,
+  IFCitationsCol,
+  ImpactFactorCol
+};
+
+// idxNum flags chosen by xBestIndex
+enum Plan {
+  WordLookup = 1,
+  SortedByCitations = 2,
+  SortedByZScore = 4,
+  Descending = 8,
+  Slice = 16,
+};
+
+// Sorted orders of a store, rebuilt when the store changes
+struct StatsIndex {
+  size_t version = std::numeric_limits<size_t>::max();
+  std::vector<uint32_t> byCitations;
+  std::vector<uint32_t> byZScore;
+};
+
+// A store exposed by a pair of tables, or by a table of slices
+struct StatsSource {
+  // null for slices
+  KeywordStore& (*store)();
+  // name of the first column
+  const char* wordColumn;
+  // false if the types are all the same, the column is hidden then
+  bool hasTypes;
+  // the store of a slice and the name of its hidden column, null if not
+  // sliced; slices are small, they are scanned without sorted index
+  const KeywordStore& (*slice)(const std::string&);
+  const char* sliceColumn;
+  StatsIndex index;
+};
+
+// The aux data of a module
+struct StatsTable {
+  StatsSource* source;
+  bool perYear;
+};
+
+struct StatsVTab : sqlite3_vtab {
+  StatsSource* source = nullptr;
+  bool perYear = false;
+};
+
+struct StatsCursor : sqlite3_vtab_cursor {
+  // store scanned, the one of the slice if sliced
+  const KeywordStore* store = nullptr;
+  std::string slice;
+  // keywords to visit, in output order
+  std::vector<uint32_t> rows;
+  size_t pos = 0;
+  // year window of the current keyword (keyword_year_stats only)
+  size_t year = 0;
+  size_t lastYear = 0;
+  double minYear = -std::numeric_limits<double>::infinity();
+  double maxYear = std::numeric_limits<double>::infinity();
+  sqlite3_int64 rowid = 0;
+};
+
+StatsIndex& getIndex(StatsSource& source) {
+  StatsIndex& index = source.index;
+  const KeywordStore& store = source.store();
+  if (index.version == store.version()) {
+    return index;
+  }
+
+  index.byCitations.clear();
+  index.byCitations.reserve(store.nKeywords());
+  for (uint32_t i = 0; i < store.size(); i++) {
+    if (!store.isRemoved(i)) {
+      index.byCitations.push_back(i);
+    }
+  }
+  index.byZScore = index.byCitations;
+  std::stable_sort(index.byCitations.begin(), index.byCitations.end(),
+                   [&store](uint32_t a, uint32_t b) {
+                     return store.totalCitations(a) < store.totalCitations(b);
+                   });
+  std::stable_sort(index.byZScore.begin(), index.byZScore.end(),
+                   [&store](uint32_t a, uint32_t b) {
+                     return store.zScore(a) < store.zScore(b);
+                   });
+  index.version = store.version();
+  return index;
+}
+
+bool isRange(unsigned char op) {
+  return op == SQLITE_INDEX_CONSTRAINT_EQ || op == SQLITE_INDEX_CONSTRAINT_GT ||
+         op == SQLITE_INDEX_CONSTRAINT_GE || op == SQLITE_INDEX_CONSTRAINT_LT ||
+         op == SQLITE_INDEX_CONSTRAINT_LE;
+}
+
+// idxStr holds one op character per argv value, in argv order
+char toOpChar(unsigned char op) {
+  switch (op) {
+    case SQLITE_INDEX_CONSTRAINT_EQ:
+      return '=';
+    case SQLITE_INDEX_CONSTRAINT_GT:
+      return '>';
+    case SQLITE_INDEX_CONSTRAINT_GE:
+      return 'g';
+    case SQLITE_INDEX_CONSTRAINT_LT:
+      return '<';
+    case SQLITE_INDEX_CONSTRAINT_LE:
+      return 'l';
+  }
+  return '?';
+}
+
+bool isNumeric(sqlite3_value* value) {
+  int type = sqlite3_value_numeric_type(value);
+  return type == SQLITE_INTEGER || type == SQLITE_FLOAT;
+}
+
+int xConnect(sqlite3* handle, void* aux, int, const char* const*,
+             sqlite3_vtab** ppVtab, char**) {
+  const StatsTable* table = static_cast<const StatsTable*>(aux);
+  std::string wordColumn = table->source->wordColumn;
+  std::string schema =
+      table->perYear
+          ? "CREATE TABLE x(" + wordColumn +
+                " TEXT, year INTEGER, citations INTEGER, new_papers INTEGER, "
+                "if_citations INTEGER, impact_factor REAL)"
+          : "CREATE TABLE x(" + wordColumn + " TEXT, types TEXT" +
+                (table->source->hasTypes ? "" : " HIDDEN") +
+                ", total_citations INTEGER, z_score REAL, papers INTEGER, "
+                "first_year INTEGER, last_year INTEGER, slope REAL, "
+                "growth_rate REAL, acceleration REAL, share REAL, "
+                "impact_factor REAL, h_index INTEGER, g_index INTEGER, "
+                "median_citations REAL, top_decile_citations INTEGER" +
+                (table->source->sliceColumn
+                     ? std::string(", ") + table->source->sliceColumn +
+                           " TEXT HIDDEN"
+                     : "") +
+                ")";
+  int rc = sqlite3_declare_vtab(handle, schema.c_str());
+  if (rc != SQLITE_OK) {
+    return rc;
+  }
+  StatsVTab* vtab = new StatsVTab();
+  vtab->source = table->source;
+  vtab->perYear = table->perYear;
+  *ppVtab = vtab;
+  return SQLITE_OK;
+}
+
+int xDisconnect(sqlite3_vtab* vtab) {
+  delete static_cast<StatsVTab*>(vtab);
+  return SQLITE_OK;
+}
+
+int xBestIndex(sqlite3_vtab* pVtab, sqlite3_index_info* info) {
+  StatsVTab* vtab = static_cast<StatsVTab*>(pVtab);
+  bool perYear = vtab->perYear;
+  bool sliced = vtab->source->slice != nullptr;
+  // a slice is a fraction of the keywords
+  double nRows =
+      sliced ? 1000 : std::max<size_t>(vtab->source->store().nKeywords(), 1);
+  int plan = 0;
+  int nArgs = 0;
+  std::string ops;
+
+  // a slice table needs the name of its slice, as a table-valued function
+  for (int i = 0; i < info->nConstraint && sliced; i++) {
+    const auto& c = info->aConstraint[i];
+    if (c.usable && c.iColumn == SliceCol &&
+        c.op == SQLITE_INDEX_CONSTRAINT_EQ) {
+      plan |= Slice;
+      info->aConstraintUsage[i].argvIndex = ++nArgs;
+      ops += 's';
+      break;
+    }
+  }
+  if (sliced && !(plan & Slice)) {
+    return SQLITE_CONSTRAINT;
+  }
+
+  // an equality on the word is a hash lookup, nothing beats it
+  for (int i = 0; i < info->nConstraint; i++) {
+    const auto& c = info->aConstraint[i];
+    if (c.usable && c.iColumn == WordCol &&
+        c.op == SQLITE_INDEX_CONSTRAINT_EQ) {
+      plan |= WordLookup;
+      info->aConstraintUsage[i].argvIndex = ++nArgs;
+      ops += 'w';
+      break;
+    }
+  }
+
+  // ranges on the year (per-year table) or on one of the sorted columns
+  int rangeColumn = -1;
+  if (perYear) {
+    rangeColumn = YearCol;
+  } else if (!(plan & WordLookup) && !sliced) {
+    if (info->nOrderBy == 1 &&
+        (info->aOrderBy[0].iColumn == TotalCitationsCol ||
+         info->aOrderBy[0].iColumn == ZScoreCol)) {
+      rangeColumn = info->aOrderBy[0].iColumn;
+    }
+    for (int i = 0; i < info->nConstraint && rangeColumn == -1; i++) {
+      const auto& c = info->aConstraint[i];
+      if (c.usable && isRange(c.op) &&
+          (c.iColumn == TotalCitationsCol || c.iColumn == ZScoreCol)) {
+        rangeColumn = c.iColumn;
+      }
+    }
+    if (rangeColumn != -1) {
+      plan |= rangeColumn == TotalCitationsCol ? SortedByCitations
+                                               : SortedByZScore;
+    }
+  }
+
+  size_t nRanges = 0;
+  for (int i = 0; i < info->nConstraint && rangeColumn != -1; i++) {
+    const auto& c = info->aConstraint[i];
+    if (c.usable && c.iColumn == rangeColumn && isRange(c.op)) {
+      info->aConstraintUsage[i].argvIndex = ++nArgs;
+      ops += toOpChar(c.op);
+      nRanges++;
+    }
+  }
+
+  if (!perYear && info->nOrderBy == 1) {
+    bool desc = info->aOrderBy[0].desc;
+    if (plan & WordLookup) {
+      // at most one row
+      info->orderByConsumed = 1;
+    } else if (rangeColumn == info->aOrderBy[0].iColumn) {
+      info->orderByConsumed = 1;
+      if (desc) plan |= Descending;
+    }
+  }
+
+  // the constraints are double checked by sqlite, the cost model only has to
+  // rank the plans
+  double rows = nRows;
+  if (plan & WordLookup) {
+    rows = perYear ? 10 : 1;
+  } else if (nRanges > 0) {
+    rows = nRows / (2 * nRanges);
+  }
+  if (perYear && !(plan & WordLookup)) {
+    rows *= nRanges > 0 ? 2 : 10;
+  }
+  info->estimatedCost = rows;
+  info->estimatedRows = static_cast<sqlite3_int64>(rows);
+  info->idxNum = plan;
+  info->idxStr = sqlite3_mprintf("%s", ops.c_str());
+  info->needToFreeIdxStr = 1;
+  return SQLITE_OK;
+}
+
+int xOpen(sqlite3_vtab*, sqlite3_vtab_cursor** ppCursor) {
+  *ppCursor = new StatsCursor();
+  return SQLITE_OK;
+}
+
+int xClose(sqlite3_vtab_cursor* cur) {
+  delete static_cast<StatsCursor*>(cur);
+  return SQLITE_OK;
+}
+
+// moves to the first year of the current keyword inside the year window,
+// skipping keywords with no such year
+void seekYear(StatsCursor* cursor, const KeywordStore& store) {
+  while (cursor->pos < cursor->rows.size()) {
+    auto [first, last] = store.yearSpan(cursor->rows[cursor->pos]);
+    double from = std::max<double>(first, cursor->minYear);
+    double to = std::min<double>(last, cursor->maxYear);
+    if (first <= last && from <= to) {
+      cursor->year = from;
+      cursor->lastYear = to;
+      return;
+    }
+    cursor->pos++;
+  }
+}
+
+int xFilter(sqlite3_vtab_cursor* cur, int plan, const char* ops, int argc,
+            sqlite3_value** argv) {
+  StatsCursor* cursor = static_cast<StatsCursor*>(cur);
+  StatsVTab* vtab = static_cast<StatsVTab*>(cur->pVtab);
+  bool perYear = vtab->perYear;
+
+  cursor->rows.clear();
+  cursor->pos = 0;
+  cursor->rowid = 0;
+  cursor->minYear = -std::numeric_limits<double>::infinity();
+  cursor->maxYear = std::numeric_limits<double>::infinity();
+
+  int arg = 0;
+  if (plan & Slice) {
+    const unsigned char* text = sqlite3_value_text(argv[arg++]);
+    cursor->slice = text ? reinterpret_cast<const char*>(text) : "";
+    cursor->store = &vtab->source->slice(cursor->slice);
+  } else {
+    cursor->store = &vtab->source->store();
+  }
+  const KeywordStore& store = *cursor->store;
+
+  if (plan & WordLookup) {
+    const unsigned char* text = sqlite3_value_text(argv[arg++]);
+    if (text != nullptr) {
+      auto row = store.find(reinterpret_cast<const char*>(text));
+      if (row != KeywordStore::npos) {
+        cursor->rows.push_back(row);
+      }
+    }
+  } else if (plan & (SortedByCitations | SortedByZScore)) {
+    StatsIndex& index = getIndex(*vtab->source);
+    const auto& sorted =
+        plan & SortedByCitations ? index.byCitations : index.byZScore;
+    auto valueOf = [&store, plan](uint32_t row) {
+      return plan & SortedByCitations
+                 ? static_cast<double>(store.totalCitations(row))
+                 : store.zScore(row);
+    };
+    auto lo = sorted.begin();
+    auto hi = sorted.end();
+    for (; arg < argc; arg++) {
+      if (!isNumeric(argv[arg])) continue;
+      double v = sqlite3_value_double(argv[arg]);
+      auto below = [&](uint32_t row, double x) { return valueOf(row) < x; };
+      auto above = [&](double x, uint32_t row) { return x < valueOf(row); };
+      switch (ops[arg]) {
+        case '=':
+          lo = std::max(lo, std::lower_bound(lo, hi, v, below));
+          hi = std::min(hi, std::upper_bound(lo, hi, v, above));
+          break;
+        case '>':
+          lo = std::max(lo, std::upper_bound(lo, hi, v, above));
+          break;
+        case 'g':
+          lo = std::max(lo, std::lower_bound(lo, hi, v, below));
+          break;
+        case '<':
+          hi = std::min(hi, std::lower_bound(lo, hi, v, below));
+          break;
+        case 'l':
+          hi = std::min(hi, std::upper_bound(lo, hi, v, above));
+          break;
+      }
+    }
+    if (lo < hi) {
+      cursor->rows.assign(lo, hi);
+    }
+    if (plan & Descending) {
+      std::reverse(cursor->rows.begin(), cursor->rows.end());
+    }
+  } else {
+    cursor->rows.reserve(store.nKeywords());
+    for (uint32_t i = 0; i < store.size(); i++) {
+      if (!store.isRemoved(i)) {
+        cursor->rows.push_back(i);
+      }
+    }
+  }
+
+  if (perYear) {
+    for (; arg < argc; arg++) {
+      if (!isNumeric(argv[arg])) continue;
+      double v = sqlite3_value_double(argv[arg]);
+      switch (ops[arg]) {
+        case '=':
+          cursor->minYear = std::max(cursor->minYear, std::ceil(v));
+          cursor->maxYear = std::min(cursor->maxYear, std::floor(v));
+          break;
+        case '>':
+          cursor->minYear = std::max(cursor->minYear, std::floor(v) + 1);
+          break;
+        case 'g':
+          cursor->minYear = std::max(cursor->minYear, std::ceil(v));
+          break;
+        case '<':
+          cursor->maxYear = std::min(cursor->maxYear, std::ceil(v) - 1);
+          break;
+        case 'l':
+          cursor->maxYear = std::min(cursor->maxYear, std::floor(v));
+          break;
+      }
+    }
+    seekYear(cursor, store);
+  }
+  return SQLITE_OK;
+}
+
+int xNext(sqlite3_vtab_cursor* cur) {
+  StatsCursor* cursor = static_cast<StatsCursor*>(cur);
+  StatsVTab* vtab = static_cast<StatsVTab*>(cur->pVtab);
+  cursor->rowid++;
+  if (vtab->perYear && cursor->year < cursor->lastYear) {
+    cursor->year++;
+    return SQLITE_OK;
+  }
+  cursor->pos++;
+  if (vtab->perYear) {
+    seekYear(cursor, *cursor->store);
+  }
+  return SQLITE_OK;
+}
+
+int xEof(sqlite3_vtab_cursor* cur) {
+  StatsCursor* cursor = static_cast<StatsCursor*>(cur);
+  return cursor->pos >= cursor->rows.size();
+}
+
+int xColumn(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int column) {
+  StatsCursor* cursor = static_cast<StatsCursor*>(cur);
+  StatsVTab* vtab = static_cast<StatsVTab*>(cur->pVtab);
+  const KeywordStore& store = *cursor->store;
+  KeywordStore::Row row = cursor->rows[cursor->pos];
+  const std::string& word = store.word(row);
+
+  if (vtab->perYear) {
+    size_t year = cursor->year;
+    switch (column) {
+      case YearWordCol:
+        sqlite3_result_text(ctx, word.c_str(), word.size(), SQLITE_TRANSIENT);
+        break;
+      case YearCol:
+        sqlite3_result_int64(ctx, year);
+        break;
+      case CitationsCol:
+        sqlite3_result_int64(ctx, store.citations(row, year));
+        break;
+      case NewPapersCol:
+        sqlite3_result_int64(ctx, store.newPapers(row, year));
+        break;
+      case IFCitationsCol:
+        sqlite3_result_int64(ctx, store.ifCitations(row, year));
+        break;
+      case ImpactFactorCol:
+        sqlite3_result_double(ctx, store.impactFactor(row, year));
+        break;
+    }
+    return SQLITE_OK;
+  }
+
+  switch (column) {
+    case WordCol:
+      sqlite3_result_text(ctx, word.c_str(), word.size(), SQLITE_TRANSIENT);
+      break;
+    case TypesCol: {
+      std::string typeStr = store.typesToString(row);
+      sqlite3_result_text(ctx, typeStr.c_str(), typeStr.size(),
+                          SQLITE_TRANSIENT);
+      break;
+    }
+    case TotalCitationsCol:
+      sqlite3_result_int64(ctx, store.totalCitations(row));
+      break;
+    case ZScoreCol:
+      sqlite3_result_double(ctx, store.zScore(row));
+      break;
+    case PapersCol:
+      sqlite3_result_int64(ctx, store.nPapers(row));
+      break;
+    case FirstYearCol:
+    case LastYearCol: {
+      auto [first, last] = store.yearSpan(row);
+      if (first > last) {
+        sqlite3_result_null(ctx);
+      } else {
+        sqlite3_result_int64(ctx, column == FirstYearCol ? first : last);
+      }
+      break;
+    }
+    case SlopeCol:
+      sqlite3_result_double(ctx, store.slope(row));
+      break;
+    case GrowthRateCol:
+      sqlite3_result_double(ctx, store.growthRate(row));
+      break;
+    case AccelerationCol:
+      sqlite3_result_double(ctx, store.acceleration(row));
+      break;
+    case ShareCol:
+      sqlite3_result_double(ctx, store.share(row));
+      break;
+    case ImpactFactorStatsCol:
+      sqlite3_result_double(ctx, store.refYearImpactFactor(row));
+      break;
+    case HIndexCol:
+      sqlite3_result_int64(ctx, store.hIndex(row));
+      break;
+    case GIndexCol:
+      sqlite3_result_int64(ctx, store.gIndex(row));
+      break;
+    case MedianCitationsCol:
+      sqlite3_result_double(ctx, store.medianCitations(row));
+      break;
+    case TopDecileCitationsCol:
+      sqlite3_result_int64(ctx, store.topDecileCitations(row));
+      break;
+    case SliceCol:
+      sqlite3_result_text(ctx, cursor->slice.c_str(), cursor->slice.size(),
+                          SQLITE_TRANSIENT);
+      break;
+  }
+  return SQLITE_OK;
+}
+
+int xRowid(sqlite3_vtab_cursor* cur, sqlite3_int64* pRowid) {
+  *pRowid = static_cast<StatsCursor*>(cur)->rowid;
+  return SQLITE_OK;
+}
+
+sqlite3_module makeModule() {
+  sqlite3_module module = {};
+  module.iVersion = 0;
+  // xCreate is null: eponymous-only, the tables exist in every schema
+  module.xCreate = nullptr;
+  module.xConnect = xConnect;
+  module.xBestIndex = xBestIndex;
+  module.xDisconnect = xDisconnect;
+  module.xDestroy = xDisconnect;
+  module.xOpen = xOpen;
+  module.xClose = xClose;
+  module.xFilter = xFilter;
+  module.xNext = xNext;
+  module.xEof = xEof;
+  module.xColumn = xColumn;
+  module.xRowid = xRowid;
+  return module;
+}
+
+}  // namespace
+
+void registerKeywordStatsModule(SQLite::Database& database) {
+  static const sqlite3_module module = makeModule();
+  // the aux pointer tells the tables apart
+  static StatsSource keywords = {
+      getKeywordStore, "word", true, nullptr, nullptr, {}};
+  static StatsSource authors = {
+      getAuthorStore, "name", false, nullptr, nullptr, {}};
+  static StatsSource countries = {
+      nullptr,
+      "word",
+      true,
+      [](const std::string& name) -> const KeywordStore& {
+        return getKeywordSlice(SliceDimension::Country, name);
+      },
+      "country",
+      {}};
+  static StatsSource institutions = {
+      nullptr,
+      "word",
+      true,
+      [](const std::string& name) -> const KeywordStore& {
+        return getKeywordSlice(SliceDimension::Institution, name);
+      },
+      "institution",
+      {}};
+  static StatsSource venues = {
+      nullptr,
+      "word",
+      true,
+      [](const std::string& name) -> const KeywordStore& {
+        return getKeywordSlice(SliceDimension::Venue, name);
+      },
+      "venue",
+      {}};
+  static StatsTable tables[] = {
+      {&keywords, false},  {&keywords, true},        {&authors, false},
+      {&authors, true},    {&countries, false},      {&institutions, false},
+      {&venues, false}};
+  const char* names[] = {"keyword_stats",         "keyword_year_stats",
+                         "author_stats",          "author_year_stats",
+                         "keyword_country_stats", "keyword_institution_stats",
+                         "keyword_venue_stats"};
+  for (size_t i = 0; i < std::size(tables); i++) {
+    database.check(sqlite3_create_module(database.getHandle(), names[i],
+                                         &module, &tables[i]));
+  }
+}
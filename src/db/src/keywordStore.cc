@@ -0,0 +1,713 @@
+#include "keywordStore.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "dbUtils.hh"
+
+KeywordStore::Row KeywordStore::find(const std::string& word) const {
+  auto it = _wordToRow.find(word);
+  return it == _wordToRow.end() ? npos : it->second;
+}
+
+KeywordStore::PaperId KeywordStore::findPaper(const std::string& doi) const {
+  auto it = _paperIds.find(doi);
+  return it == _paperIds.end() ? npos : it->second;
+}
+
+KeywordStore::Row KeywordStore::appendRow(const std::string& word) {
+  Row row = _words.size();
+  _words.push_back(word);
+  _types.push_back(0);
+  _totalCitations.push_back(0);
+  _zScores.push_back(0);
+  _citationFrom.push_back(std::numeric_limits<uint16_t>::max());
+  _citationTo.push_back(0);
+  _nPapers.push_back(0);
+  _paperFrom.push_back(std::numeric_limits<uint16_t>::max());
+  _paperTo.push_back(0);
+  _slopes.push_back(0);
+  _growthRates.push_back(0);
+  _accelerations.push_back(0);
+  _hIndexes.push_back(0);
+  _gIndexes.push_back(0);
+  _medianCitations.push_back(0);
+  _topDecileCitations.push_back(0);
+  _paperCitationEnds.push_back(row == 0 ? 0 : _paperCitationEnds[row - 1]);
+  _hasDetail.push_back(0);
+  _removed.push_back(0);
+  _papers.emplace_back();
+  _wordToRow.emplace(word, row);
+  _citations.resize(_citations.size() + _nYears, 0);
+  _newPapers.resize(_newPapers.size() + _nYears, 0);
+  _ifCitations.resize(_ifCitations.size() + _nYears, 0);
+  _impactFactors.resize(_impactFactors.size() + _nYears, 0);
+  _citationSums.resize(_citationSums.size() + _nYears + 1, 0);
+  _citationSquareSums.resize(_citationSquareSums.size() + _nYears + 1, 0);
+  _newPaperSums.resize(_newPaperSums.size() + _nYears + 1, 0);
+  _ifCitationSums.resize(_ifCitationSums.size() + _nYears + 1, 0);
+  _version++;
+  return row;
+}
+
+KeywordStore::Row KeywordStore::add(const KeywordSummary& summary) {
+  Row row = find(summary._word);
+  if (row == npos) {
+    row = appendRow(summary._word);
+  }
+
+  size_t first = summary._firstPaperYear;
+  size_t last = summary._lastPaperYear;
+  if (!summary._yearToCitations.empty()) {
+    first = std::min(first, summary._yearToCitations.begin()->first);
+    last = std::max(last, summary._yearToCitations.rbegin()->first);
+  }
+  if (first <= last) {
+    ensureYears(first, last);
+  }
+
+  for (auto type : summary._type) {
+    _types[row] |= 1u << type;
+  }
+  _totalCitations[row] += summary._totalCitations;
+  for (const auto& [year, citations] : summary._yearToCitations) {
+    cell(_citations, row, year) += citations;
+    _citationFrom[row] = std::min<size_t>(_citationFrom[row], year);
+    _citationTo[row] = std::max<size_t>(_citationTo[row], year);
+  }
+  for (const auto& [year, papers] : summary._yearToNewPapers) {
+    cell(_newPapers, row, year) += papers;
+  }
+  for (const auto& [year, citations] : summary._yearToIFCitations) {
+    cell(_ifCitations, row, year) += citations;
+  }
+  for (uint32_t citations : summary._paperCitations) {
+    _pendingPaperCitations.emplace_back(row, citations);
+  }
+  _nPapers[row] += summary._nPapers;
+  if (summary._firstPaperYear <= summary._lastPaperYear) {
+    extendPaperYears(row, summary._firstPaperYear, summary._lastPaperYear);
+  }
+  _version++;
+  return row;
+}
+
+// Total citations of a paper of a result
+static size_t citationsOf(const KeywordQueryResult& kqr,
+                          const std::string& doi) {
+  auto it = kqr._paperCitations.find(doi);
+  return it == kqr._paperCitations.end() ? 0 : it->second;
+}
+
+KeywordStore::Row KeywordStore::add(const KeywordQueryResult& kqr) {
+  Row row = find(kqr._word);
+  if (row == npos) {
+    // all the papers of a new keyword are in the result
+    row = appendRow(kqr._word);
+    _hasDetail[row] = 1;
+  }
+  merge(row, kqr);
+  return row;
+}
+
+void KeywordStore::merge(Row row, const KeywordQueryResult& kqr) {
+  size_t first = std::numeric_limits<size_t>::max();
+  size_t last = 0;
+  auto extend = [&](const auto& yearToValue) {
+    if (!yearToValue.empty()) {
+      first = std::min(first, yearToValue.begin()->first);
+      last = std::max(last, yearToValue.rbegin()->first);
+    }
+  };
+  extend(kqr._yearToCitations);
+  extend(kqr._yearToPapers);
+  extend(kqr._yearToCitationInYearOfPapersPublishedThePreviousTwoYears);
+  if (first <= last) {
+    ensureYears(first, last);
+  }
+
+  for (auto type : kqr._type) {
+    _types[row] |= 1u << type;
+  }
+  _totalCitations[row] += kqr._totalCitations;
+  for (const auto& [year, citations] : kqr._yearToCitations) {
+    cell(_citations, row, year) += citations;
+    _citationFrom[row] = std::min<size_t>(_citationFrom[row], year);
+    _citationTo[row] = std::max<size_t>(_citationTo[row], year);
+  }
+  if (!kqr._yearToPapers.empty()) {
+    extendPaperYears(row, kqr._yearToPapers.begin()->first,
+                     kqr._yearToPapers.rbegin()->first);
+  }
+
+  if (_hasDetail[row]) {
+    addPaperCitations(row, mergeDetail(row, kqr));
+  } else {
+    // the papers are new, the detail is read with them when needed
+    for (const auto& [year, papers] : kqr._yearToPapers) {
+      for (const auto& doi : papers) {
+        size_t citations = citationsOf(kqr, doi);
+        addPaper(doi, year, citations);
+        _pendingPaperCitations.emplace_back(row, citations);
+      }
+      cell(_newPapers, row, year) += papers.size();
+    }
+    for (const auto& [year, citations] :
+         kqr._yearToCitationInYearOfPapersPublishedThePreviousTwoYears) {
+      cell(_ifCitations, row, year) += citations;
+    }
+    _nPapers[row] += kqr._papers.size();
+  }
+  _version++;
+}
+
+PaperSet KeywordStore::mergeDetail(Row row, const KeywordQueryResult& kqr) {
+  for (const auto& [year, citations] :
+       kqr._yearToCitationInYearOfPapersPublishedThePreviousTwoYears) {
+    cell(_ifCitations, row, year) += citations;
+  }
+
+  std::vector<PaperId> ids;
+  for (const auto& [year, papers] : kqr._yearToPapers) {
+    for (const auto& doi : papers) {
+      ids.push_back(addPaper(doi, year, citationsOf(kqr, doi)));
+    }
+  }
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  return addPapers(row, PaperSet::fromSorted(ids));
+}
+
+void KeywordStore::setDetail(Row row, const KeywordQueryResult& kqr) {
+  size_t first = std::numeric_limits<size_t>::max();
+  size_t last = 0;
+  auto extend = [&](const auto& yearToValue) {
+    if (!yearToValue.empty()) {
+      first = std::min(first, yearToValue.begin()->first);
+      last = std::max(last, yearToValue.rbegin()->first);
+    }
+  };
+  extend(kqr._yearToPapers);
+  extend(kqr._yearToCitationInYearOfPapersPublishedThePreviousTwoYears);
+  if (first <= last) {
+    ensureYears(first, last);
+  }
+
+  std::fill_n(_newPapers.begin() + row * _nYears, _nYears, 0);
+  std::fill_n(_ifCitations.begin() + row * _nYears, _nYears, 0);
+  _papers[row] = PaperSet();
+  _nPapers[row] = 0;
+  // the citations of the papers are already in the summary
+  mergeDetail(row, kqr);
+  _hasDetail[row] = 1;
+}
+
+std::string KeywordStore::uniqueWord(const std::string& word) const {
+  std::string unique = word;
+  for (size_t n = 2; find(unique) != npos; n++) {
+    unique = word + " (" + std::to_string(n) + ")";
+  }
+  return unique;
+}
+
+KeywordStore::Row KeywordStore::addUnion(const std::string& word,
+                                         const std::vector<Row>& rows) {
+  Row row = appendRow(uniqueWord(word));
+  _hasDetail[row] = 1;
+  PaperSet papers;
+  for (Row from : rows) {
+    _types[row] |= _types[from];
+    _totalCitations[row] += _totalCitations[from];
+    _citationFrom[row] = std::min(_citationFrom[row], _citationFrom[from]);
+    _citationTo[row] = std::max(_citationTo[row], _citationTo[from]);
+    _paperFrom[row] = std::min(_paperFrom[row], _paperFrom[from]);
+    _paperTo[row] = std::max(_paperTo[row], _paperTo[from]);
+    for (size_t i = 0; i < _nYears; i++) {
+      _citations[row * _nYears + i] += _citations[from * _nYears + i];
+      _ifCitations[row * _nYears + i] += _ifCitations[from * _nYears + i];
+    }
+    papers |= _papers[from];
+  }
+  addPaperCitations(row, addPapers(row, papers));
+  return row;
+}
+
+KeywordStore KeywordStore::paperSetStore(
+    const std::string& word, const PaperSet& papers,
+    const std::vector<Row>& terms,
+    const std::map<size_t, size_t>& yearToCitations,
+    const std::map<size_t, size_t>& yearToIFCitations, size_t refYear) const {
+  KeywordStore store;
+  if (_nYears > 0) {
+    store.ensureYears(_firstYear, lastYear());
+  }
+  if (!yearToCitations.empty()) {
+    store.ensureYears(yearToCitations.begin()->first,
+                      yearToCitations.rbegin()->first);
+  }
+  Row row = store.appendRow(word);
+  store._hasDetail[row] = 1;
+  for (Row term : terms) {
+    store._types[row] |= _types[term];
+  }
+  for (const auto& [year, citations] : yearToCitations) {
+    store.cell(store._citations, row, year) += citations;
+    store._citationFrom[row] = std::min<size_t>(store._citationFrom[row], year);
+    store._citationTo[row] = std::max<size_t>(store._citationTo[row], year);
+  }
+  for (const auto& [year, citations] : yearToIFCitations) {
+    store.cell(store._ifCitations, row, year) += citations;
+  }
+  size_t first = std::numeric_limits<size_t>::max();
+  size_t last = 0;
+  papers.forEach([&](PaperId id) {
+    size_t year = _paperYears[id];
+    store.cell(store._newPapers, row, year)++;
+    store._totalCitations[row] += _paperCitations[id];
+    store._pendingPaperCitations.emplace_back(row, _paperCitations[id]);
+    first = std::min(first, year);
+    last = std::max(last, year);
+  });
+  store._nPapers[row] = papers.cardinality();
+  if (first <= last) {
+    store.extendPaperYears(row, first, last);
+  }
+
+  store.computeZScore(row, refYear);
+  store.computeTrends(refYear);
+  // the share among the keywords of this store
+  store._refYearCitations = _refYearCitations;
+  return store;
+}
+
+void KeywordStore::remove(Row row) {
+  if (_removed[row]) {
+    return;
+  }
+  // the word may be added again, as a new row
+  auto it = _wordToRow.find(_words[row]);
+  if (it != _wordToRow.end() && it->second == row) {
+    _wordToRow.erase(it);
+  }
+  _refYearCitations -= trendCitations(row);
+  _removed[row] = 1;
+  _nRemoved++;
+  _papers[row] = PaperSet();
+  _movedPaperCitations.erase(row);
+  _version++;
+}
+
+void KeywordStore::clear() {
+  size_t version = _version;
+  *this = KeywordStore();
+  _version = version + 1;
+}
+
+void KeywordStore::computeZScore(Row row, size_t refYear) {
+  auto [from, to] = citationYears(row);
+  _zScores[row] =
+      from > to ? 0
+                : ::computeZScore(citationsRow(row) + (from - _firstYear), from,
+                                  to - from + 1, refYear);
+}
+
+// Calls f on the rows [0, nRows): rows are independent, they are split into
+// contiguous blocks computed on their own threads
+template <typename F>
+static void forEachRowInBlocks(size_t nRows, F f) {
+  constexpr size_t minRowsPerBlock = 4096;
+  size_t nBlocks = std::max<size_t>(
+      1, std::min<size_t>(std::thread::hardware_concurrency(),
+                          nRows / minRowsPerBlock));
+  size_t rowsPerBlock = (nRows + nBlocks - 1) / nBlocks;
+  auto computeBlock = [nRows, rowsPerBlock, &f](size_t block) {
+    size_t end = std::min(nRows, (block + 1) * rowsPerBlock);
+    for (size_t row = block * rowsPerBlock; row < end; row++) {
+      f(row);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t block = 1; block < nBlocks; block++) {
+    workers.emplace_back(computeBlock, block);
+  }
+  computeBlock(0);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+void KeywordStore::computeZScores(size_t refYear) {
+  _zScores.detach();
+  forEachRowInBlocks(size(),
+                     [this, refYear](Row row) { computeZScore(row, refYear); });
+  _version++;
+}
+
+void KeywordStore::computeTrend(Row row, size_t refYear) {
+  updateTrends({row}, refYear);
+}
+
+void KeywordStore::updateTrends(const std::vector<Row>& rows,
+                                size_t refYear) {
+  // the windows of every row end earlier than the reference year if the
+  // store has no data up to it: new years move them
+  if (refYear != _trendRefYear ||
+      std::min(refYear, lastYear()) != std::min(refYear, _trendLastYear)) {
+    computeTrends(refYear);
+    return;
+  }
+  movePaperCitations();
+  std::vector<Row> changed = rows;
+  std::sort(changed.begin(), changed.end());
+  changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+  for (Row row : changed) {
+    if (_removed[row]) {
+      continue;
+    }
+    // the sum loses the citations of the last pass of the row
+    _refYearCitations -= trendCitations(row);
+    computeRowTrend(row, refYear);
+    _refYearCitations += trendCitations(row);
+  }
+  _version++;
+}
+
+std::pair<const uint32_t*, size_t> KeywordStore::paperCitationList(
+    Row row) const {
+  if (!_movedPaperCitations.empty()) {
+    auto it = _movedPaperCitations.find(row);
+    if (it != _movedPaperCitations.end()) {
+      return {it->second.data(), it->second.size()};
+    }
+  }
+  uint64_t begin = row == 0 ? 0 : _paperCitationEnds[row - 1];
+  return {_paperCitationLists.data() + begin,
+          _paperCitationEnds[row] - begin};
+}
+
+void KeywordStore::computeRowTrend(Row row, size_t refYear) {
+  // the rows are computed in parallel: the columns are only read, through
+  // the const accessors, so that a view of a snapshot is not copied by
+  // several threads at once
+  const auto& citationFrom = std::as_const(_citationFrom);
+
+  // citation distribution, from the citations sorted in decreasing order
+  auto [sorted, nCited] = std::as_const(*this).paperCitationList(row);
+  size_t h = 0;
+  while (h < nCited && sorted[h] >= h + 1) {
+    h++;
+  }
+  size_t g = 0;
+  uint64_t sum = 0;
+  while (g < nCited && sum + sorted[g] >= (g + 1) * (g + 1)) {
+    sum += sorted[g++];
+  }
+  _hIndexes[row] = h;
+  _gIndexes[row] = g;
+  _medianCitations[row] =
+      nCited == 0 ? 0
+                  : (static_cast<double>(sorted[(nCited - 1) / 2]) +
+                     sorted[nCited / 2]) /
+                        2;
+  _topDecileCitations[row] = nCited == 0 ? 0 : sorted[(nCited + 9) / 10 - 1];
+
+  double* impactFactors = _impactFactors.data() + row * _nYears;
+  const uint32_t* newPapers = newPapersRow(row);
+  const uint32_t* ifCitations = _ifCitations.data() + row * _nYears;
+  for (size_t i = 0; i < _nYears; i++) {
+    impactFactors[i] =
+        computeImpactFactor(ifCitations[i], i >= 1 ? newPapers[i - 1] : 0,
+                            i >= 2 ? newPapers[i - 2] : 0);
+  }
+
+  // prefix sums of the windowed metrics
+  const uint32_t* yearCitations = citationsRow(row);
+  uint64_t* citationSums = _citationSums.data() + row * (_nYears + 1);
+  uint64_t* citationSquareSums =
+      _citationSquareSums.data() + row * (_nYears + 1);
+  uint32_t* newPaperSums = _newPaperSums.data() + row * (_nYears + 1);
+  uint64_t* ifCitationSums = _ifCitationSums.data() + row * (_nYears + 1);
+  for (size_t i = 0; i < _nYears; i++) {
+    citationSums[i + 1] = citationSums[i] + yearCitations[i];
+    citationSquareSums[i + 1] =
+        citationSquareSums[i] +
+        static_cast<uint64_t>(yearCitations[i]) * yearCitations[i];
+    newPaperSums[i + 1] = newPaperSums[i] + newPapers[i];
+    ifCitationSums[i + 1] = ifCitationSums[i] + ifCitations[i];
+  }
+
+  size_t from = citationFrom[row];
+  size_t to = std::min(refYear, lastYear());
+  if (from > to || _nYears == 0) {
+    _slopes[row] = _growthRates[row] = _accelerations[row] = 0;
+    return;
+  }
+  // the years after the last citations count as zeros
+  const uint32_t* values = citationsRow(row) + (from - _firstYear);
+  size_t n = to - from + 1;
+  _slopes[row] = computeSlope(values, n);
+  _growthRates[row] = computeGrowthRate(values, n);
+  size_t k = std::min(trendYears, n / 2);
+  _accelerations[row] =
+      k < 2 ? 0
+            : computeSlope(values + n - k, k) -
+                  computeSlope(values + n - 2 * k, k);
+}
+
+void KeywordStore::computeTrends(size_t refYear) {
+  _trendRefYear = refYear;
+  _trendLastYear = lastYear();
+  _refYearCitations = 0;
+  for (Row row = 0; row < size(); row++) {
+    if (!_removed[row]) {
+      _refYearCitations += citations(row, refYear);
+    }
+  }
+  sortPaperCitations();
+  forEachRowInBlocks(size(), [this, refYear](Row row) {
+    computeRowTrend(row, refYear);
+  });
+  _version++;
+}
+
+std::pair<size_t, size_t> KeywordStore::clamp(const YearRange& range) const {
+  return {std::max(range.from, _firstYear), std::min(range.to, lastYear())};
+}
+
+uint64_t KeywordStore::citationsIn(Row row, const YearRange& range) const {
+  auto [from, to] = clamp(range);
+  return from > to ? 0 : sumIn(_citationSums, row, from, to);
+}
+
+uint64_t KeywordStore::newPapersIn(Row row, const YearRange& range) const {
+  auto [from, to] = clamp(range);
+  return from > to ? 0 : sumIn(_newPaperSums, row, from, to);
+}
+
+double KeywordStore::zScoreIn(Row row, const YearRange& range) const {
+  // the series of computeZScore, restricted to the range
+  auto [from, to] = clamp(range);
+  from = std::max<size_t>(from, _citationFrom[row]);
+  size_t last = std::min<size_t>(to, _citationTo[row]);
+  if (from > to || from > last || last - from + 1 < 2) {
+    return 0;
+  }
+  // n^2 variance = n sum(x^2) - sum(x)^2, exact in integers so that a flat
+  // series has no deviation
+  size_t n = last - from + 1;
+  uint64_t sum = sumIn(_citationSums, row, from, last);
+  unsigned __int128 deviation =
+      static_cast<unsigned __int128>(n) *
+          sumIn(_citationSquareSums, row, from, last) -
+      static_cast<unsigned __int128>(sum) * sum;
+  if (deviation == 0) {
+    return 0;
+  }
+  double mean = static_cast<double>(sum) / n;
+  double stdDev = std::sqrt(static_cast<double>(deviation)) / n;
+  // the reference year of the trends, not a partial current year
+  auto valueIn = [&](size_t year, double missing) -> double {
+    return year >= from && year <= last ? citations(row, year) : missing;
+  };
+  size_t refYear = std::min(to, _trendRefYear);
+  double lastYear = valueIn(refYear, 0);
+  double lastButOneYear = valueIn(refYear - 1, lastYear);
+  return ((lastYear + lastButOneYear) / 2 - mean) / stdDev;
+}
+
+double KeywordStore::impactFactorIn(Row row, const YearRange& range) const {
+  auto [from, to] = clamp(range);
+  if (from > to) {
+    return 0;
+  }
+  // the papers of the year before and two years before each year of the
+  // range, clamped to the years of the store
+  auto papersIn = [&](size_t shift) -> uint64_t {
+    size_t first = std::max(from - std::min(from, shift), _firstYear);
+    if (to < _firstYear + shift) {
+      return 0;
+    }
+    return sumIn(_newPaperSums, row, first, to - shift);
+  };
+  return computeImpactFactor(sumIn(_ifCitationSums, row, from, to),
+                             papersIn(1), papersIn(2));
+}
+
+std::vector<KeywordType> KeywordStore::types(Row row) const {
+  std::vector<KeywordType> ret;
+  for (auto type :
+       {SubjectArea, IndexTerm, AuthorKeyword, TitleKeyword, Author}) {
+    if (hasType(row, type)) {
+      ret.push_back(type);
+    }
+  }
+  return ret;
+}
+
+std::string KeywordStore::typesToString(Row row) const {
+  std::string typeStr;
+  for (auto type : types(row)) {
+    typeStr += (typeStr.empty() ? "" : ", ") + toString(type);
+  }
+  return typeStr;
+}
+
+bool KeywordStore::hasPaper(Row row, const std::string& doi) const {
+  auto it = _paperIds.find(doi);
+  return it != _paperIds.end() && _papers[row].contains(it->second);
+}
+
+std::pair<size_t, size_t> KeywordStore::citationYears(Row row) const {
+  return {_citationFrom[row], _citationTo[row]};
+}
+
+std::pair<size_t, size_t> KeywordStore::yearSpan(Row row) const {
+  auto [first, last] = citationYears(row);
+  return {std::min<size_t>(first, _paperFrom[row]),
+          std::max<size_t>(last, _paperTo[row])};
+}
+
+void KeywordStore::ensureYears(size_t first, size_t last) {
+  if (_nYears > 0) {
+    first = std::min(first, _firstYear);
+    last = std::max(last, lastYear());
+  }
+  size_t nYears = last - first + 1;
+  if (first == _firstYear && nYears == _nYears) {
+    return;
+  }
+
+  size_t offset = _nYears > 0 ? _firstYear - first : 0;
+  auto widen = [&](auto& matrix) {
+    using T = std::remove_reference_t<decltype(matrix[0])>;
+    std::vector<T> widened(size() * nYears, 0);
+    for (Row row = 0; row < size(); row++) {
+      std::copy_n(matrix.begin() + row * _nYears, _nYears,
+                  widened.begin() + row * nYears + offset);
+    }
+    matrix.swap(widened);
+  };
+  widen(_citations);
+  widen(_newPapers);
+  widen(_ifCitations);
+  widen(_impactFactors);
+  // the prefix sums start with 0 and keep their total after the old years
+  auto widenSums = [&](auto& sums) {
+    using T = std::remove_reference_t<decltype(sums[0])>;
+    std::vector<T> widened(size() * (nYears + 1), 0);
+    for (Row row = 0; row < size(); row++) {
+      auto old = sums.begin() + row * (_nYears + 1);
+      auto out = widened.begin() + row * (nYears + 1);
+      std::copy_n(old, _nYears + 1, out + offset);
+      std::fill(out + offset + _nYears + 1, out + nYears + 1, old[_nYears]);
+    }
+    sums.swap(widened);
+  };
+  widenSums(_citationSums);
+  widenSums(_citationSquareSums);
+  widenSums(_newPaperSums);
+  widenSums(_ifCitationSums);
+  _firstYear = first;
+  _nYears = nYears;
+}
+
+void KeywordStore::extendPaperYears(Row row, size_t first, size_t last) {
+  _paperFrom[row] = std::min<size_t>(_paperFrom[row], first);
+  _paperTo[row] = std::max<size_t>(_paperTo[row], last);
+}
+
+KeywordStore::PaperId KeywordStore::addPaper(const std::string& doi,
+                                             size_t year, size_t citations) {
+  auto [it, inserted] = _paperIds.emplace(doi, _paperDois.size());
+  if (inserted) {
+    _paperDois.push_back(doi);
+    _paperYears.push_back(year);
+    _paperCitations.push_back(citations);
+  }
+  return it->second;
+}
+
+PaperSet KeywordStore::addPapers(Row row, const PaperSet& papers) {
+  PaperSet added = papers - _papers[row];
+  if (added.empty()) {
+    return added;
+  }
+  added.forEach(
+      [&](PaperId id) { cell(_newPapers, row, _paperYears[id])++; });
+  _nPapers[row] += added.cardinality();
+  _papers[row] |= added;
+  return added;
+}
+
+void KeywordStore::addPaperCitations(Row row, const PaperSet& papers) {
+  papers.forEach([&](PaperId id) {
+    _pendingPaperCitations.emplace_back(row, _paperCitations[id]);
+  });
+}
+
+void KeywordStore::sortPaperCitations() {
+  if (_pendingPaperCitations.empty() && _movedPaperCitations.empty()) {
+    return;
+  }
+  // one pass over the arrays: the queued citations go after the ones of
+  // their row, the moved arrays replace theirs
+  std::vector<uint64_t> nAdded(size(), 0);
+  for (const auto& entry : _pendingPaperCitations) {
+    nAdded[entry.first]++;
+  }
+  std::vector<uint64_t> ends(size());
+  uint64_t end = 0;
+  for (Row row = 0; row < size(); row++) {
+    end += paperCitationList(row).second + nAdded[row];
+    ends[row] = end;
+  }
+  std::vector<uint32_t> lists(end);
+  for (Row row = 0; row < size(); row++) {
+    auto [old, n] = paperCitationList(row);
+    std::copy(old, old + n, lists.begin() + (row == 0 ? 0 : ends[row - 1]));
+  }
+  for (const auto& [row, citations] : _pendingPaperCitations) {
+    lists[ends[row] - nAdded[row]--] = citations;
+  }
+  _pendingPaperCitations.clear();
+  _pendingPaperCitations.shrink_to_fit();
+  _movedPaperCitations.clear();
+
+  // the arrays are contiguous, the unchanged ones are still sorted
+  forEachRowInBlocks(size(), [&](Row row) {
+    auto begin = lists.begin() + (row == 0 ? 0 : ends[row - 1]);
+    auto end = lists.begin() + ends[row];
+    if (!std::is_sorted(begin, end, std::greater<uint32_t>())) {
+      std::sort(begin, end, std::greater<uint32_t>());
+    }
+  });
+  _paperCitationEnds.swap(ends);
+  _paperCitationLists.swap(lists);
+}
+
+void KeywordStore::movePaperCitations() {
+  std::vector<Row> changed;
+  for (const auto& [row, citations] : _pendingPaperCitations) {
+    auto it = _movedPaperCitations.find(row);
+    if (it == _movedPaperCitations.end()) {
+      auto [old, n] = paperCitationList(row);
+      it = _movedPaperCitations
+               .emplace(row, std::vector<uint32_t>(old, old + n))
+               .first;
+    }
+    it->second.push_back(citations);
+    changed.push_back(row);
+  }
+  _pendingPaperCitations.clear();
+  std::sort(changed.begin(), changed.end());
+  changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+  for (Row row : changed) {
+    auto& list = _movedPaperCitations[row];
+    std::sort(list.begin(), list.end(), std::greater<uint32_t>());
+  }
+}
@@ -0,0 +1,289 @@
+#include "paperSet.hh"
+
+#include <algorithm>
+#include <iterator>
+
+static size_t popcount(const uint64_t* bitmap, size_t nWords) {
+  size_t count = 0;
+  for (size_t w = 0; w < nWords; w++) {
+    count += __builtin_popcountll(bitmap[w]);
+  }
+  return count;
+}
+
+static std::unique_ptr<uint64_t[]> copyBitmap(const uint64_t* bitmap,
+                                              size_t nWords) {
+  std::unique_ptr<uint64_t[]> copy(new uint64_t[nWords]);
+  std::copy_n(bitmap, nWords, copy.get());
+  return copy;
+}
+
+PaperSet::Container::Container(const Container& other)
+    : key(other.key), cardinality(other.cardinality), array(other.array) {
+  if (other.isBitmap()) {
+    bitmap = copyBitmap(other.bitmap.get(), bitmapWords);
+  }
+}
+
+PaperSet::Container& PaperSet::Container::operator=(const Container& other) {
+  if (this != &other) {
+    *this = Container(other);
+  }
+  return *this;
+}
+
+bool PaperSet::Container::contains(uint16_t low) const {
+  if (isBitmap()) {
+    return bitmap[low / 64] >> (low % 64) & 1;
+  }
+  return std::binary_search(array.begin(), array.end(), low);
+}
+
+void PaperSet::Container::toBitmap() {
+  if (isBitmap()) {
+    return;
+  }
+  bitmap.reset(new uint64_t[bitmapWords]());
+  for (uint16_t low : array) {
+    bitmap[low / 64] |= uint64_t(1) << (low % 64);
+  }
+  array.clear();
+  array.shrink_to_fit();
+}
+
+void PaperSet::Container::normalize() {
+  if (isBitmap() && cardinality <= arrayMax) {
+    array.reserve(cardinality);
+    for (size_t w = 0; w < bitmapWords; w++) {
+      for (uint64_t word = bitmap[w]; word; word &= word - 1) {
+        array.push_back(w * 64 + __builtin_ctzll(word));
+      }
+    }
+    bitmap.reset();
+  } else if (!isBitmap() && cardinality > arrayMax) {
+    toBitmap();
+  }
+}
+
+PaperSet PaperSet::fromSorted(const std::vector<Id>& ids) {
+  PaperSet set;
+  for (Id id : ids) {
+    uint16_t key = id >> 16;
+    if (set._containers.empty() || set._containers.back().key != key) {
+      set._containers.emplace_back();
+      set._containers.back().key = key;
+    }
+    Container& c = set._containers.back();
+    c.array.push_back(id & 0xFFFF);
+    c.cardinality++;
+  }
+  for (auto& c : set._containers) {
+    c.normalize();
+  }
+  return set;
+}
+
+void PaperSet::add(Id id) {
+  uint16_t key = id >> 16;
+  uint16_t low = id & 0xFFFF;
+  auto it = std::lower_bound(
+      _containers.begin(), _containers.end(), key,
+      [](const Container& c, uint16_t key) { return c.key < key; });
+  if (it == _containers.end() || it->key != key) {
+    it = _containers.insert(it, Container());
+    it->key = key;
+  }
+  if (it->isBitmap()) {
+    uint64_t& word = it->bitmap[low / 64];
+    uint64_t bit = uint64_t(1) << (low % 64);
+    it->cardinality += !(word & bit);
+    word |= bit;
+    return;
+  }
+  auto pos = std::lower_bound(it->array.begin(), it->array.end(), low);
+  if (pos == it->array.end() || *pos != low) {
+    it->array.insert(pos, low);
+    it->cardinality++;
+    it->normalize();
+  }
+}
+
+bool PaperSet::contains(Id id) const {
+  uint16_t key = id >> 16;
+  auto it = std::lower_bound(
+      _containers.begin(), _containers.end(), key,
+      [](const Container& c, uint16_t key) { return c.key < key; });
+  return it != _containers.end() && it->key == key &&
+         it->contains(id & 0xFFFF);
+}
+
+size_t PaperSet::cardinality() const {
+  size_t count = 0;
+  for (const auto& c : _containers) {
+    count += c.cardinality;
+  }
+  return count;
+}
+
+PaperSet::Container PaperSet::unite(const Container& a, const Container& b) {
+  Container c;
+  c.key = a.key;
+  if (!a.isBitmap() && !b.isBitmap()) {
+    c.array.reserve(a.array.size() + b.array.size());
+    std::set_union(a.array.begin(), a.array.end(), b.array.begin(),
+                   b.array.end(), std::back_inserter(c.array));
+    c.cardinality = c.array.size();
+  } else {
+    const Container& dense = a.isBitmap() ? a : b;
+    const Container& other = a.isBitmap() ? b : a;
+    c.bitmap = copyBitmap(dense.bitmap.get(), bitmapWords);
+    if (other.isBitmap()) {
+      for (size_t w = 0; w < bitmapWords; w++) {
+        c.bitmap[w] |= other.bitmap[w];
+      }
+    } else {
+      for (uint16_t low : other.array) {
+        c.bitmap[low / 64] |= uint64_t(1) << (low % 64);
+      }
+    }
+    c.cardinality = popcount(c.bitmap.get(), bitmapWords);
+  }
+  c.normalize();
+  return c;
+}
+
+PaperSet::Container PaperSet::intersect(const Container& a,
+                                        const Container& b) {
+  Container c;
+  c.key = a.key;
+  if (a.isBitmap() && b.isBitmap()) {
+    c.bitmap.reset(new uint64_t[bitmapWords]);
+    for (size_t w = 0; w < bitmapWords; w++) {
+      c.bitmap[w] = a.bitmap[w] & b.bitmap[w];
+    }
+    c.cardinality = popcount(c.bitmap.get(), bitmapWords);
+  } else if (!a.isBitmap() && !b.isBitmap()) {
+    std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(),
+                          b.array.end(), std::back_inserter(c.array));
+    c.cardinality = c.array.size();
+  } else {
+    const Container& sparse = a.isBitmap() ? b : a;
+    const Container& dense = a.isBitmap() ? a : b;
+    for (uint16_t low : sparse.array) {
+      if (dense.contains(low)) {
+        c.array.push_back(low);
+      }
+    }
+    c.cardinality = c.array.size();
+  }
+  c.normalize();
+  return c;
+}
+
+PaperSet::Container PaperSet::subtract(const Container& a,
+                                       const Container& b) {
+  Container c;
+  c.key = a.key;
+  if (a.isBitmap()) {
+    c.bitmap = copyBitmap(a.bitmap.get(), bitmapWords);
+    if (b.isBitmap()) {
+      for (size_t w = 0; w < bitmapWords; w++) {
+        c.bitmap[w] &= ~b.bitmap[w];
+      }
+    } else {
+      for (uint16_t low : b.array) {
+        c.bitmap[low / 64] &= ~(uint64_t(1) << (low % 64));
+      }
+    }
+    c.cardinality = popcount(c.bitmap.get(), bitmapWords);
+  } else if (b.isBitmap()) {
+    for (uint16_t low : a.array) {
+      if (!b.contains(low)) {
+        c.array.push_back(low);
+      }
+    }
+    c.cardinality = c.array.size();
+  } else {
+    std::set_difference(a.array.begin(), a.array.end(), b.array.begin(),
+                        b.array.end(), std::back_inserter(c.array));
+    c.cardinality = c.array.size();
+  }
+  c.normalize();
+  return c;
+}
+
+PaperSet& PaperSet::operator|=(const PaperSet& other) {
+  *this = *this | other;
+  return *this;
+}
+
+PaperSet PaperSet::operator|(const PaperSet& other) const {
+  PaperSet set;
+  auto a = _containers.begin();
+  auto b = other._containers.begin();
+  while (a != _containers.end() || b != other._containers.end()) {
+    if (b == other._containers.end() ||
+        (a != _containers.end() && a->key < b->key)) {
+      set._containers.push_back(*a++);
+    } else if (a == _containers.end() || b->key < a->key) {
+      set._containers.push_back(*b++);
+    } else {
+      set._containers.push_back(unite(*a++, *b++));
+    }
+  }
+  return set;
+}
+
+PaperSet PaperSet::operator&(const PaperSet& other) const {
+  PaperSet set;
+  auto a = _containers.begin();
+  auto b = other._containers.begin();
+  while (a != _containers.end() && b != other._containers.end()) {
+    if (a->key < b->key) {
+      a++;
+    } else if (b->key < a->key) {
+      b++;
+    } else {
+      Container c = intersect(*a++, *b++);
+      if (c.cardinality > 0) {
+        set._containers.push_back(std::move(c));
+      }
+    }
+  }
+  return set;
+}
+
+PaperSet PaperSet::operator-(const PaperSet& other) const {
+  PaperSet set;
+  auto b = other._containers.begin();
+  for (const auto& a : _containers) {
+    while (b != other._containers.end() && b->key < a.key) {
+      b++;
+    }
+    if (b == other._containers.end() || b->key != a.key) {
+      set._containers.push_back(a);
+      continue;
+    }
+    Container c = subtract(a, *b);
+    if (c.cardinality > 0) {
+      set._containers.push_back(std::move(c));
+    }
+  }
+  return set;
+}
+
+std::vector<PaperSet::Id> PaperSet::toVector() const {
+  std::vector<Id> ids;
+  ids.reserve(cardinality());
+  forEach([&ids](Id id) { ids.push_back(id); });
+  return ids;
+}
+
+size_t PaperSet::memoryUsage() const {
+  size_t bytes = sizeof(PaperSet) + _containers.capacity() * sizeof(Container);
+  for (const auto& c : _containers) {
+    bytes += c.array.capacity() * sizeof(uint16_t) +
+             (c.isBitmap() ? bitmapWords * sizeof(uint64_t) : 0);
+  }
+  return bytes;
+}
@@ -14,6 +14,20 @@ extern bool isilent;
 extern bool psilent;
 extern std::vector<std::string> bibFiles;
 extern std::string dbFile;
+///--shard-per-dataset
+extern bool shardPerDataset;
+///--ingest-workers
+extern size_t ingestWorkers;
+///--query
+extern std::string query;
+///--bursts, 0 if not given
+extern size_t burstsSince;
+///--benchmark
+extern bool benchmark;
+///--synonyms, empty if not given
+extern std::string synonymsFile;
+///--expression, empty if not given
+extern std::string expression;
 }  // namespace clc
 
 // harm stat
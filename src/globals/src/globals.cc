@@ -8,6 +8,13 @@ bool isilent = false;
 bool psilent = false;
 std::vector<std::string> bibFiles;
 std::string dbFile = "research_papers.db";
+bool shardPerDataset = false;
+size_t ingestWorkers = 1;
+std::string query = "";
+size_t burstsSince = 0;
+bool benchmark = false;
+std::string synonymsFile = "";
+std::string expression = "";
 }  // namespace clc
 
 // harm stat
@@ -1,15 +1,23 @@
 #pragma once
 
 #include <QCheckBox>
+#include <QComboBox>
+#include <QDragEnterEvent>
+#include <QDropEvent>
 #include <QLabel>
 #include <QLineEdit>
 #include <QListView>
 #include <QMainWindow>
+#include <QProgressBar>
+#include <QSpinBox>
 #include <QSplitter>
 #include <QStandardItemModel>  // Include QStandardItemModel for the table
 #include <QStringListModel>
 #include <QTableView>
 #include <QTimer>
+#include <memory>
+
+#include "ingest.hh"
 
 class MainWindow : public QMainWindow {
   Q_OBJECT
@@ -20,12 +28,20 @@ class MainWindow : public QMainWindow {
   void setupConnections();
   ~MainWindow();
 
+  // Ingests the .bib files in the background, the window stays usable
+  void startIngest(const std::vector<std::string> &bibFiles);
+
  private slots:
   void startTextChangedTimer();
   void updateTable();
   void onTableClicked(const QModelIndex &index);
   void openChartWindow(const QString &keyword);
   void openListOfPapers(const std::string &keyword);
+  void openRelatedKeywords(const std::string &keyword);
+  void openRelatedOfSelectedRows();
+  void openKeywordVariants(const std::string &keyword);
+  void openVariantsOfSelectedRows();
+  void openVenueComparison();
   void keyPressEvent(QKeyEvent *event) override;
 
   void resizeEvent(QResizeEvent *event) override;
@@ -35,9 +51,30 @@ class MainWindow : public QMainWindow {
   void onPapersTableClicked(const QModelIndex &index);
   void decreaseSize();
   void increaseSize();
+  void dragEnterEvent(QDragEnterEvent *event) override;
+  void dropEvent(QDropEvent *event) override;
 
  private:
   void setSliderLimits(size_t max);
+  // Bounds of the year range to the years of the store, the range follows
+  // them while it covers them all
+  void setYearLimits(const KeywordStore &store);
+  // Years of the windowed metrics, all of them if the range covers the store
+  YearRange selectedYears(const KeywordStore &store) const;
+  // Lists the venues of the databases in the venue filter, keeping the
+  // selected one
+  void updateVenues();
+  // True if the table is filtered by a venue; its rows are not the ones of
+  // the cached store, they can not be removed or united
+  bool isVenueSelected() const;
+  // Keywords of the selected venue, all of them if none is
+  const KeywordStore &selectedVenueStore() const;
+  // True if a keyword of the table is the expression searched last, which is
+  // not in the cached store
+  bool isExpression(const std::string &word) const;
+  void onIngestProgress(const IngestProgress &progress);
+  void onIngestBatch(const KeywordDelta &delta);
+  void onIngestFinished();
 
   QLineEdit *keySearch_textBox = nullptr;
   QTableView *keywords_tableView = nullptr;
@@ -51,8 +88,19 @@ class MainWindow : public QMainWindow {
   QLabel *min_label = nullptr;
   QLabel *max_label = nullptr;
   QSlider *maxRows_slider = nullptr;
+  QSpinBox *yearFrom_spinBox = nullptr;
+  QSpinBox *yearTo_spinBox = nullptr;
+  QComboBox *venue_comboBox = nullptr;
+  QLabel *ingest_label = nullptr;
+  QProgressBar *ingest_progressBar = nullptr;
+  QTimer *ingestRefresh_timer = nullptr;
+
+  std::unique_ptr<BackgroundIngest> ingest;
 
   int maxTabRows = 1000;  // Default maximum number of rows
+  // the boolean expression searched last, row 0 of a store of its own, see
+  // updateTable
+  KeywordStore expression;
 };
 
 void runGui(int argc, char *argv[]);
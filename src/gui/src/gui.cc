@@ -5,8 +5,10 @@
 #include <QHeaderView>
 #include <QLabel>
 #include <QMessageBox>
+#include <QMimeData>
 #include <QPainter>
 #include <QPushButton>
+#include <QStatusBar>
 #include <QStandardItemModel>
 #include <QTabWidget>
 #include <QTableWidget>
@@ -15,7 +17,9 @@
 #include <QtCharts/QChartView>
 #include <QtCharts/QLineSeries>
 #include <QtCharts/QValueAxis>
+#include <filesystem>
 
+#include "globals.hh"
 #include "message.hh"
 
 static void printTimeSeries(QLineSeries *series);
@@ -23,6 +27,7 @@ static void printTimeSeries(QLineSeries *series);
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
   setupLayout();
   setupConnections();
+  updateVenues();
 }
 
 void MainWindow::setupLayout() {
@@ -42,12 +47,21 @@ void MainWindow::setupLayout() {
   // Left part ------------------------------------------------------
 
   // Set up the table view
-  keywordsTab_model = new QStandardItemModel(0, 4, this);
+  keywordsTab_model = new QStandardItemModel(0, 13, this);
   // Set headers for the table
   keywordsTab_model->setHeaderData(0, Qt::Horizontal, "Keyword");
   keywordsTab_model->setHeaderData(1, Qt::Horizontal, "Type");
   keywordsTab_model->setHeaderData(2, Qt::Horizontal, "Total Citations");
   keywordsTab_model->setHeaderData(3, Qt::Horizontal, "z-score");
+  keywordsTab_model->setHeaderData(4, Qt::Horizontal, "Slope");
+  keywordsTab_model->setHeaderData(5, Qt::Horizontal, "Growth Rate");
+  keywordsTab_model->setHeaderData(6, Qt::Horizontal, "Acceleration");
+  keywordsTab_model->setHeaderData(7, Qt::Horizontal, "Share");
+  keywordsTab_model->setHeaderData(8, Qt::Horizontal, "Impact Factor");
+  keywordsTab_model->setHeaderData(9, Qt::Horizontal, "h-index");
+  keywordsTab_model->setHeaderData(10, Qt::Horizontal, "g-index");
+  keywordsTab_model->setHeaderData(11, Qt::Horizontal, "Median Citations");
+  keywordsTab_model->setHeaderData(12, Qt::Horizontal, "Top 10% Citations");
   // Set the keywordsTab_model for the table view
   keywords_tableView->setModel(keywordsTab_model);
   // Set the table to be non-editable
@@ -82,6 +96,18 @@ void MainWindow::setupLayout() {
   area_checkbox->setChecked(true);
   authorKeyword_checkbox->setChecked(true);
 
+  // Initialize the year range, its bounds are the years of the keywords
+  yearFrom_spinBox = new QSpinBox(this);
+  yearTo_spinBox = new QSpinBox(this);
+  yearFrom_spinBox->setPrefix("From ");
+  yearTo_spinBox->setPrefix("To ");
+  yearFrom_spinBox->setRange(0, 0);
+  yearTo_spinBox->setRange(0, 0);
+
+  // Initialize the venue filter, the venues are listed by updateVenues
+  venue_comboBox = new QComboBox(this);
+  venue_comboBox->setSizeAdjustPolicy(QComboBox::AdjustToContents);
+
   // Add the text box, min label, slider, and max label to the layout
   textSlider_hlayout->addWidget(min_label);
   textSlider_hlayout->addWidget(maxRows_slider);
@@ -89,6 +115,9 @@ void MainWindow::setupLayout() {
   textSlider_hlayout->addWidget(authorKeyword_checkbox);
   textSlider_hlayout->addWidget(indexTerm_checkbox);
   textSlider_hlayout->addWidget(area_checkbox);
+  textSlider_hlayout->addWidget(yearFrom_spinBox);
+  textSlider_hlayout->addWidget(yearTo_spinBox);
+  textSlider_hlayout->addWidget(venue_comboBox);
 
   // Add textSlider_hlayout and keywords_tableView to the left layout
   leftLayout->addLayout(textSlider_hlayout);
@@ -108,6 +137,20 @@ void MainWindow::setupLayout() {
   tabWidget->setMovable(true);
   // Add the right widget to the splitter
   splitter->addWidget(tabWidget);
+
+  // Status bar ------------------------------------------------------
+  ingest_label = new QLabel(this);
+  ingest_progressBar = new QProgressBar(this);
+  ingest_progressBar->setMaximumWidth(300);
+  statusBar()->addWidget(ingest_label);
+  statusBar()->addPermanentWidget(ingest_progressBar);
+  ingest_progressBar->hide();
+
+  // refreshes the table at most once per second during an ingest
+  ingestRefresh_timer = new QTimer(this);
+
+  // .bib files can be dropped on the window
+  setAcceptDrops(true);
 }
 
 void MainWindow::setupConnections() {
@@ -139,6 +182,104 @@ void MainWindow::setupConnections() {
           &MainWindow::updateTable);
   connect(area_checkbox, &QCheckBox::stateChanged, this,
           &MainWindow::updateTable);
+
+  // the year range ranks the cached keywords again, without any query
+  connect(yearFrom_spinBox, &QSpinBox::valueChanged, this,
+          &MainWindow::updateTable);
+  connect(yearTo_spinBox, &QSpinBox::valueChanged, this,
+          &MainWindow::updateTable);
+
+  // the slices of the venues are aggregated together, switching venues ranks
+  // the cached keywords of the venue
+  connect(venue_comboBox, &QComboBox::currentIndexChanged, this,
+          &MainWindow::updateTable);
+
+  // the table holds the top rows only, sorting by a metric column searches
+  // again for the top rows of the new order
+  connect(keywords_tableView->horizontalHeader(),
+          &QHeaderView::sortIndicatorChanged, this,
+          [this](int section, Qt::SortOrder) {
+            if (section >= 2) updateTable();
+          });
+
+  ingestRefresh_timer->setSingleShot(true);
+  connect(ingestRefresh_timer, &QTimer::timeout, this,
+          &MainWindow::updateTable);
+}
+
+void MainWindow::startIngest(const std::vector<std::string> &bibFiles) {
+  if (ingest == nullptr) {
+    // the callbacks run on the ingest thread, the work is queued to the GUI
+    // thread which owns the cached keywords and the widgets
+    ingest = std::make_unique<BackgroundIngest>(
+        [this](const IngestProgress &progress) {
+          QMetaObject::invokeMethod(
+              this, [this, progress]() { onIngestProgress(progress); },
+              Qt::QueuedConnection);
+        },
+        [this](const KeywordDelta &delta) {
+          QMetaObject::invokeMethod(
+              this, [this, delta]() { onIngestBatch(delta); },
+              Qt::QueuedConnection);
+        },
+        [this]() {
+          QMetaObject::invokeMethod(
+              this, [this]() { onIngestFinished(); }, Qt::QueuedConnection);
+        });
+  }
+  ingest->enqueue(bibFiles);
+  ingest_progressBar->show();
+}
+
+void MainWindow::onIngestProgress(const IngestProgress &progress) {
+  ingest_label->setText(
+      QString("Loading %1 (%2/%3), %4 papers added")
+          .arg(QString::fromStdString(
+              std::filesystem::path(progress.bibFile).filename().u8string()))
+          .arg(progress.filesDone + 1)
+          .arg(progress.filesTotal)
+          .arg(progress.papersInserted));
+  ingest_progressBar->setRange(0, progress.entriesTotal);
+  ingest_progressBar->setValue(progress.entriesDone);
+}
+
+void MainWindow::onIngestBatch(const KeywordDelta &delta) {
+  mergeIntoKeywordStore(delta);
+  // only refresh a table the user is looking at
+  if (keywordsTab_model->rowCount() > 0 && !ingestRefresh_timer->isActive()) {
+    ingestRefresh_timer->start(1000);
+  }
+}
+
+void MainWindow::onIngestFinished() {
+  ingest_label->setText("Loading completed");
+  ingest_progressBar->hide();
+  updateVenues();
+  if (keywordsTab_model->rowCount() > 0) {
+    ingestRefresh_timer->start(0);
+  }
+}
+
+void MainWindow::dragEnterEvent(QDragEnterEvent *event) {
+  if (event->mimeData()->hasUrls()) {
+    event->acceptProposedAction();
+  }
+}
+
+void MainWindow::dropEvent(QDropEvent *event) {
+  std::vector<std::string> bibFiles;
+  for (const QUrl &url : event->mimeData()->urls()) {
+    std::string file = url.toLocalFile().toStdString();
+    if (std::filesystem::path(file).extension() == ".bib") {
+      bibFiles.push_back(file);
+    } else {
+      messageWarning("Ignoring dropped file " + file + ", not a .bib file");
+    }
+  }
+  if (!bibFiles.empty()) {
+    event->acceptProposedAction();
+    startIngest(bibFiles);
+  }
 }
 
 void MainWindow::keyPressEvent(QKeyEvent *event) {
@@ -161,6 +302,18 @@ void MainWindow::keyPressEvent(QKeyEvent *event) {
              event->key() == Qt::Key_Backspace) {
     // Remove selected rows when Ctrl + Backspace is pressed
     removeSelectedRows();
+  } else if (event->modifiers() == Qt::ControlModifier &&
+             event->key() == Qt::Key_R) {
+    // Open the keywords related to the selected rows
+    openRelatedOfSelectedRows();
+  } else if (event->modifiers() == Qt::ControlModifier &&
+             event->key() == Qt::Key_E) {
+    // Expand the selected rows into the variants of their keywords
+    openVariantsOfSelectedRows();
+  } else if (event->modifiers() == Qt::ControlModifier &&
+             event->key() == Qt::Key_D) {
+    // Compare the selected rows (all if none) across the venues
+    openVenueComparison();
   } else if (event->modifiers() == Qt::ControlModifier &&
              event->key() == Qt::Key_A) {
     // Select all rows in the table
@@ -198,7 +351,10 @@ void MainWindow::keyPressEvent(QKeyEvent *event) {
   }
 }
 
-MainWindow::~MainWindow() {}
+MainWindow::~MainWindow() {
+  // stop the ingest thread while the window can still receive its callbacks
+  ingest.reset();
+}
 
 void MainWindow::resizeEvent(QResizeEvent *event) {
   QMainWindow::resizeEvent(event);
@@ -329,6 +485,9 @@ void runGui(int argc, char *argv[]) {
   QApplication app(argc, argv);
   MainWindow window;
   window.showMaximized();
+  if (!clc::bibFiles.empty()) {
+    window.startIngest(clc::bibFiles);
+  }
   app.exec();
   messageInfo("GUI closed");
 }
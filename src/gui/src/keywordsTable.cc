@@ -1,3 +1,4 @@
+#include <QHeaderView>
 #include <QTabWidget>
 #include <QTableWidget>
 #include <QTableWidgetItem>
@@ -5,24 +6,134 @@
 #include <QtCharts/QChartView>
 #include <QtCharts/QLineSeries>
 #include <QtCharts/QValueAxis>
+#include <algorithm>
 #include <iostream>
+#include <iterator>
+#include <vector>
 
 #include "db.hh"
 #include "dbUtils.hh"
 #include "gui.hh"
+#include "keywordExpression.hh"
 #include "message.hh"
 
+// Orders of the metric columns of the keywords table, from column 2: all of
+// them are sorted by the search
+static const KeywordOrder columnOrders[] = {
+    KeywordOrder::Citations,    KeywordOrder::ZScore,
+    KeywordOrder::Slope,        KeywordOrder::GrowthRate,
+    KeywordOrder::Acceleration, KeywordOrder::Share,
+    KeywordOrder::ImpactFactor, KeywordOrder::HIndex,
+    KeywordOrder::GIndex,       KeywordOrder::MedianCitations,
+    KeywordOrder::TopDecileCitations};
+static const int firstMetricColumn = 2;
+
+// Items of a row of the keywords table, the citations, z-score and impact
+// factor of a year range are its windowed metrics
+static QList<QStandardItem *> keywordRowItems(const KeywordStore &store,
+                                              KeywordStore::Row row,
+                                              const YearRange &years) {
+  QList<QStandardItem *> rowItems;
+  rowItems << new QStandardItem(QString::fromStdString(store.word(row)));
+  rowItems << new QStandardItem(
+      QString::fromStdString(store.typesToString(row)));
+
+  // new integer item for citations
+  auto citationItem = new QStandardItem();
+  citationItem->setData(
+      static_cast<qlonglong>(years.isAll() ? store.totalCitations(row)
+                                           : store.citationsIn(row, years)),
+      Qt::DisplayRole);  // Cast to qlonglong
+  rowItems << citationItem;
+
+  // new double item for z-score
+  double zScore =
+      years.isAll() ? store.zScore(row) : store.zScoreIn(row, years);
+  auto zScoreItem = new QStandardItem();
+  zScoreItem->setData(zScore, Qt::DisplayRole);
+  // set color to green if z-score is greater than 1
+  if (zScore >= 1.f) {
+    zScoreItem->setData(QColor(Qt::darkGreen), Qt::BackgroundRole);
+  } else if (zScore < -1.f) {
+    zScoreItem->setData(QColor(Qt::darkRed), Qt::BackgroundRole);
+  }
+  rowItems << zScoreItem;
+
+  // trend metrics and impact factor of the reference year
+  for (double value :
+       {store.slope(row), store.growthRate(row), store.acceleration(row),
+        store.share(row),
+        years.isAll() ? store.refYearImpactFactor(row)
+                      : store.impactFactorIn(row, years)}) {
+    auto item = new QStandardItem();
+    item->setData(value, Qt::DisplayRole);
+    rowItems << item;
+  }
+
+  // distribution of the citations of the papers
+  for (qlonglong value :
+       {static_cast<qlonglong>(store.hIndex(row)),
+        static_cast<qlonglong>(store.gIndex(row))}) {
+    auto item = new QStandardItem();
+    item->setData(value, Qt::DisplayRole);
+    rowItems << item;
+  }
+  auto medianItem = new QStandardItem();
+  medianItem->setData(store.medianCitations(row), Qt::DisplayRole);
+  rowItems << medianItem;
+  auto topDecileItem = new QStandardItem();
+  topDecileItem->setData(static_cast<qlonglong>(store.topDecileCitations(row)),
+                         Qt::DisplayRole);
+  rowItems << topDecileItem;
+  return rowItems;
+}
+
 void MainWindow::setSliderLimits(size_t max) {
   maxRows_slider->setRange(1, max);  // Adjust range as needed
   max_label->setText(QString::number(max));
 }
 
+void MainWindow::setYearLimits(const KeywordStore &store) {
+  if (store.nYears() == 0) {
+    return;
+  }
+  int first = static_cast<int>(store.firstYear());
+  int last = static_cast<int>(store.lastYear());
+  bool coversAll = yearFrom_spinBox->value() == yearFrom_spinBox->minimum() &&
+                   yearTo_spinBox->value() == yearTo_spinBox->maximum();
+  QSignalBlocker fromBlocker(yearFrom_spinBox);
+  QSignalBlocker toBlocker(yearTo_spinBox);
+  yearFrom_spinBox->setRange(first, last);
+  yearTo_spinBox->setRange(first, last);
+  if (coversAll) {
+    yearFrom_spinBox->setValue(first);
+    yearTo_spinBox->setValue(last);
+  }
+}
+
+YearRange MainWindow::selectedYears(const KeywordStore &store) const {
+  size_t from = yearFrom_spinBox->value();
+  size_t to = yearTo_spinBox->value();
+  YearRange years;
+  if (from > store.firstYear() || to < store.lastYear()) {
+    years.from = std::min(from, to);
+    years.to = std::max(from, to);
+  }
+  return years;
+}
+
 void MainWindow::onMaxRowsSliderValueChanged(int value) {
   maxTabRows = value;
   updateTable();  // Refresh the table view with the new max rows value
 }
 
 void MainWindow::addUnionOfSelectedRows() {
+  // the rows of a venue are the ones of its slice, aggregated apart from the
+  // cached store
+  if (isVenueSelected()) {
+    messageWarning("Select all the venues to add a union of keywords");
+    return;
+  }
   QModelIndexList selectedIndexes =
       keywords_tableView->selectionModel()->selectedRows();
 
@@ -31,89 +142,38 @@ void MainWindow::addUnionOfSelectedRows() {
     return;
   }
 
-  std::vector<KeywordQueryResult> searchResults =
-      searchKeywords(keySearch_textBox->text().toStdString());
-
-  std::vector<KeywordQueryResult> selected_keywords;
+  // Collect the selected keywords
+  std::vector<KeywordStore::Row> selected_keywords;
+  std::string unionWord;
   for (const QModelIndex &index : selectedIndexes) {
     int row = index.row();
-    QString word =
-        keywordsTab_model->data(keywordsTab_model->index(row, 0)).toString();
-
-    auto found = std::find_if(searchResults.begin(), searchResults.end(),
-                              [&word](const KeywordQueryResult &kqr) {
-                                return kqr._word == word.toStdString();
-                              });
-    messageErrorIf(found == searchResults.end(),
-                   "Selected row not found in search results");
-    selected_keywords.push_back(*found);
-  }
-
-  // Initialize a new KeywordQueryResult to store the union
-  KeywordQueryResult unionResult;
-  unionResult._word = "";
-  unionResult._type.clear();
-  unionResult._yearToCitations.clear();
-  unionResult._papers.clear();
-
-  // Collect the union of types and other fields from selected rows
-  size_t totalCitations = 0;
-  for (const auto &result : selected_keywords) {
-    unionResult._word += result._word + ", ";
-    for (auto type : result._type) {
-      unionResult._type.insert(type);
-    }
-    for (const auto &[year, citations] : result._yearToCitations) {
-      unionResult._yearToCitations[year] += citations;
-    }
-    for (const auto &[year, papers] : result._yearToPapers) {
-      unionResult._yearToPapers[year].insert(papers.begin(), papers.end());
-    }
-    for (const auto &[year, cit] :
-         result._yearToCitationInYearOfPapersPublishedThePreviousTwoYears) {
-      unionResult
-          ._yearToCitationInYearOfPapersPublishedThePreviousTwoYears[year] +=
-          cit;
+    std::string word = keywordsTab_model->data(keywordsTab_model->index(row, 0))
+                           .toString()
+                           .toStdString();
+    // the expression is not a keyword of the store
+    if (isExpression(word)) {
+      messageWarning("An expression can not be part of a union: " + word);
+      return;
     }
-
-    totalCitations += result._totalCitations;
-    unionResult._papers.insert(result._papers.begin(), result._papers.end());
+    selected_keywords.push_back(getKQR(word));
+    unionWord += word + ", ";
   }
 
   // remove trailing comma and space
-  unionResult._word = unionResult._word.substr(0, unionResult._word.size() - 2);
+  unionWord = unionWord.substr(0, unionWord.size() - 2);
   size_t maxChars = 50;
-  if (unionResult._word.size() > maxChars) {
-    unionResult._word = unionResult._word.substr(0, maxChars) + "...";
+  if (unionWord.size() > maxChars) {
+    unionWord = unionWord.substr(0, maxChars) + "...";
   }
-  unionResult._totalCitations = totalCitations;
 
-  // Recalculate z-score
-  addZScore(unionResult);
+  // Add the union to the store, the z-score is recalculated
+  KeywordStore::Row unionRow = addKQR(unionWord, selected_keywords);
+  const KeywordStore &store = getKeywordStore();
 
   // Add the union result to the table
-  QList<QStandardItem *> rowItems;
-  rowItems << new QStandardItem(QString::fromStdString(unionResult._word));
-  std::string typeStr;
-  for (auto type : unionResult._type) {
-    typeStr += toString(type) + ", ";
-  }
-  // Remove the trailing comma and space
-  typeStr = typeStr.substr(0, typeStr.size() - 2);
-
-  rowItems << new QStandardItem(QString::fromStdString(typeStr));
-  rowItems << new QStandardItem(QString::number(unionResult._totalCitations));
-  QStandardItem *zScoreItem =
-      new QStandardItem(QString::number(unionResult._zScore));
-  if (unionResult._zScore >= 1.f) {
-    zScoreItem->setData(QColor(Qt::darkGreen), Qt::BackgroundRole);
-  } else if (unionResult._zScore < -1.f) {
-    zScoreItem->setData(QColor(Qt::darkRed), Qt::BackgroundRole);
-  }
-  rowItems << zScoreItem;
-  keywordsTab_model->insertRow(0, rowItems);
+  keywordsTab_model->insertRow(
+      0, keywordRowItems(store, unionRow, selectedYears(store)));
 
-  addKQR(unionResult);
   setSliderLimits(keywordsTab_model->rowCount());
 }
 
@@ -138,16 +198,39 @@ void printTimeSeries(QLineSeries *series) {
 }
 
 void MainWindow::removeSelectedRows() {
+  // a keyword removed from the cached store would stay in the venue slices
+  if (isVenueSelected()) {
+    messageWarning("Select all the venues to remove keywords");
+    return;
+  }
   QModelIndexList selectedIndexes =
       keywords_tableView->selectionModel()->selectedRows();
 
-  // Remove selected rows from the keywordsTab_model
-  for (int i = selectedIndexes.size() - 1; i >= 0; --i) {
-    auto row = selectedIndexes.at(i).row();
-    QString word =
-        keywordsTab_model->data(keywordsTab_model->index(row, 0)).toString();
-    removeKQR(getKQR(word.toStdString()));
-    keywordsTab_model->removeRow(row);
+  // the selection is in click order, the rows are removed from the bottom so
+  // that the rows still to remove keep their index
+  std::vector<int> rows;
+  for (const QModelIndex &index : selectedIndexes) {
+    rows.push_back(index.row());
+  }
+  std::sort(rows.rbegin(), rows.rend());
+
+  for (int row : rows) {
+    std::string word = keywordsTab_model->data(keywordsTab_model->index(row, 0))
+                           .toString()
+                           .toStdString();
+    if (isExpression(word)) {
+      expression.clear();
+    } else {
+      removeKQR(getKQR(word));
+    }
+  }
+
+  // Remove selected rows from the keywordsTab_model, contiguous rows at once
+  for (size_t i = 0; i < rows.size();) {
+    size_t j = i + 1;
+    while (j < rows.size() && rows[j] == rows[j - 1] - 1) j++;
+    keywordsTab_model->removeRows(rows[j - 1], j - i);
+    i = j;
   }
 }
 
@@ -160,81 +243,84 @@ void MainWindow::startTextChangedTimer() {
 }
 
 void MainWindow::updateTable() {
-  std::vector<KeywordQueryResult> kqr_vec =
-      searchKeywords(this->keySearch_textBox->text().toStdString());
+  std::set<KeywordType> types;
+  if (indexTerm_checkbox->isChecked()) types.insert(KeywordType::IndexTerm);
+  if (authorKeyword_checkbox->isChecked()) {
+    types.insert(KeywordType::AuthorKeyword);
+  }
+  if (area_checkbox->isChecked()) types.insert(KeywordType::SubjectArea);
+
+  // the first maxTabRows keywords in the order of the view when sorted by a
+  // metric column, by descending citations otherwise
+  QHeaderView *header = keywords_tableView->horizontalHeader();
+  int sortColumn = header->sortIndicatorSection();
+  Qt::SortOrder sortOrder = header->sortIndicatorOrder();
+  int nMetricColumns = static_cast<int>(std::size(columnOrders));
+  if (sortColumn < firstMetricColumn ||
+      sortColumn >= firstMetricColumn + nMetricColumns) {
+    sortColumn = firstMetricColumn;
+    sortOrder = Qt::DescendingOrder;
+  }
+  std::string searchString = this->keySearch_textBox->text().toStdString();
+  setYearLimits(getKeywordStore());
+
+  // a boolean expression over the keywords is one row for its papers, in a
+  // store of its own that replaces the one of the previous expression; it
+  // covers all the venues
+  expression.clear();
+  bool hasOperator = KeywordExpression::hasOperator(searchString);
+  KeywordSearchResult result;
+  if (hasOperator && evaluateKeywordExpression(searchString, expression)) {
+    result.rows.push_back(0);
+    result.nMatches = 1;
+  }
+  const KeywordStore &store = hasOperator ? expression : selectedVenueStore();
+  YearRange years = selectedYears(store);
+  if (!hasOperator) {
+    result = searchKeywords(store, searchString, types,
+                            columnOrders[sortColumn - firstMetricColumn],
+                            sortOrder == Qt::DescendingOrder, maxTabRows,
+                            years);
+  }
 
   // Clear previous data from the keywordsTab_model
   keywordsTab_model->removeRows(0, keywordsTab_model->rowCount());
-  size_t maxKeywords = maxTabRows;
 
   // Add new data to the keywordsTab_model
-  for (const auto &kqr : kqr_vec) {
-    if (maxKeywords-- == 0) break;
-
-    QList<QStandardItem *> rowItems;
-    rowItems << new QStandardItem(QString::fromStdString(kqr._word));
-
-    if (!((indexTerm_checkbox->isChecked() &&
-           kqr._type.count(KeywordType::IndexTerm)) ||
-          (authorKeyword_checkbox->isChecked() &&
-           kqr._type.count(KeywordType::AuthorKeyword)) ||
-          (area_checkbox->isChecked() &&
-           kqr._type.count(KeywordType::SubjectArea)))) {
-      continue;
-    }
-
-    // build the string for the type
-    std::string typeStr;
-    for (auto type : kqr._type) {
-      typeStr += toString(type) + ", ";
-    }
-
-    // Remove the trailing comma and space
-    typeStr = typeStr.substr(0, typeStr.size() - 2);
-
-    rowItems << new QStandardItem(QString::fromStdString(typeStr));
-
-    // new integer item for citations
-    auto citationItem = new QStandardItem();
-    citationItem->setData(static_cast<qlonglong>(kqr._totalCitations),
-                          Qt::DisplayRole);  // Cast to qlonglong
-
-    rowItems << citationItem;
-
-    // new double item for z-score
-    auto zScoreItem = new QStandardItem();
-    zScoreItem->setData(kqr._zScore, Qt::DisplayRole);
-    // set color to green if z-score is greater than 1
-    if (kqr._zScore >= 1.f) {
-      zScoreItem->setData(QColor(Qt::darkGreen), Qt::BackgroundRole);
-    } else if (kqr._zScore < -1.f) {
-      zScoreItem->setData(QColor(Qt::darkRed), Qt::BackgroundRole);
-    }
-    rowItems << zScoreItem;
-    keywordsTab_model->appendRow(rowItems);
+  for (KeywordStore::Row row : result.rows) {
+    keywordsTab_model->appendRow(keywordRowItems(store, row, years));
   }
 
   // Resize columns to fit contents
   keywords_tableView->resizeColumnsToContents();
 
-  // Sort the table by the third column in descending order of citations
-  keywords_tableView->sortByColumn(2, Qt::DescendingOrder);
-  setSliderLimits(kqr_vec.size());
+  // Sort the table as the search, the rows are already in this order; the
+  // header must not ask for another search
+  QSignalBlocker blocker(header);
+  keywords_tableView->sortByColumn(sortColumn, sortOrder);
+  setSliderLimits(result.nMatches);
 }
+
+bool MainWindow::isExpression(const std::string &word) const {
+  return !expression.empty() && expression.word(0) == word;
+}
+
 void MainWindow::openChartWindow(const QString &keyword) {
-  openDB();
-  KeywordQueryResult kqr = getKQR(keyword.toStdString());
-
-  auto min_max = std::minmax_element(
-      kqr._yearToCitations.begin(), kqr._yearToCitations.end(),
-      [](const auto &a, const auto &b) { return a.first < b.first; });
-
-  // Fix missing data with zeros
-  for (size_t year = min_max.first->first; year <= min_max.second->first;
-       ++year) {
-    if (kqr._yearToCitations.count(year) == 0) {
-      kqr._yearToCitations.emplace(year, 0);
-    }
+  // the series of the table: the ones of the expression or of the selected
+  // venue
+  bool ofExpression = isExpression(keyword.toStdString());
+  const KeywordStore &store = ofExpression ? expression : selectedVenueStore();
+  KeywordStore::Row row = ofExpression ? 0 : store.find(keyword.toStdString());
+  if (row == KeywordStore::npos) {
+    messageWarning("Keyword not found: " + keyword.toStdString());
+    return;
+  }
+
+  // the years with citation data, missing years inside are zeros
+  auto [firstYear, lastYear] = store.citationYears(row);
+  if (firstYear > lastYear) {
+    messageWarning("No citations found for keyword: " + keyword.toStdString());
+    return;
   }
 
   // Create series for citation data, rate of change, and impact factor
@@ -266,39 +352,22 @@ void MainWindow::openChartWindow(const QString &keyword) {
   size_t maxCitations = 0;
   size_t maxPapers = 0;
 
-  for (const auto &[year, citations] : kqr._yearToCitations) {
+  for (size_t year = firstYear; year <= lastYear; year++) {
     if (year == getCurrentYear()) {
       continue;  // Skip the current year
     }
 
+    size_t citations = store.citations(row, year);
     citationSeries->append(year, citations);
     maxCitations = std::max(maxCitations, citations);
 
-    size_t newPapersThisYear =
-        kqr._yearToPapers.count(year) ? kqr._yearToPapers.at(year).size() : 0;
+    size_t newPapersThisYear = store.newPapers(row, year);
     numberOfPapersSeries->append(year, newPapersThisYear);
     maxPapers = std::max(maxPapers, newPapersThisYear);
 
     double impactFactor = 0;
-    if (year - min_max.first->first >= 2) {
-      size_t nPapersOneYearBefore = kqr._yearToPapers.count(year - 1)
-                                        ? kqr._yearToPapers.at(year - 1).size()
-                                        : 0;
-      size_t nPapersTwoYearsBefore = kqr._yearToPapers.count(year - 2)
-                                         ? kqr._yearToPapers.at(year - 2).size()
-                                         : 0;
-      messageErrorIf(
-          kqr._yearToCitationInYearOfPapersPublishedThePreviousTwoYears.empty(),
-          "Missing data for impact factor calculation");
-      if (nPapersOneYearBefore + nPapersTwoYearsBefore > 0 &&
-          kqr._yearToCitationInYearOfPapersPublishedThePreviousTwoYears.count(
-              year)) {
-        impactFactor =
-            static_cast<double>(
-                kqr._yearToCitationInYearOfPapersPublishedThePreviousTwoYears
-                    .at(year)) /
-            (nPapersOneYearBefore + nPapersTwoYearsBefore);
-      }
+    if (year - firstYear >= 2) {
+      impactFactor = store.impactFactor(row, year);
     }
     impactFactorSeries->append(year, impactFactor);
   }
@@ -315,8 +384,8 @@ void MainWindow::openChartWindow(const QString &keyword) {
   QValueAxis *axisX = new QValueAxis;
   axisX->setLabelFormat("%d");
   axisX->setTitleText("Year");
-  axisX->setRange(min_max.first->first, min_max.second->first - 1);
-  axisX->setTickCount(getCurrentYear() - 1 - min_max.first->first + 1);
+  axisX->setRange(firstYear, lastYear - 1);
+  axisX->setTickCount(getCurrentYear() - 1 - firstYear + 1);
   chart->addAxis(axisX, Qt::AlignBottom);
   citationSeries->attachAxis(axisX);
   impactFactorSeries->attachAxis(
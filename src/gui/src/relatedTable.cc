@@ -0,0 +1,144 @@
+#include <QHeaderView>
+#include <QTabWidget>
+#include <QTableWidget>
+#include <QTableWidgetItem>
+#include <QVBoxLayout>
+
+#include "db.hh"
+#include "gui.hh"
+#include "message.hh"
+
+// Number of related keywords listed in a tab
+static const size_t maxRelatedKeywords = 100;
+
+void MainWindow::openRelatedKeywords(const std::string &keyword) {
+  // the co-occurrences are the ones of the keywords of the cached store
+  if (isExpression(keyword)) {
+    messageWarning("No related keywords for an expression: " + keyword);
+    return;
+  }
+  const KeywordStore &store = getKeywordStore();
+  KeywordStore::Row row = getKQR(keyword);
+  std::vector<KeywordCooccurrence::Entry> related =
+      getRelatedKeywords(row, maxRelatedKeywords);
+
+  // Create a new QTableWidget for the related keywords
+  QTableWidget *table = new QTableWidget();
+  table->setRowCount(static_cast<int>(related.size()));
+  table->setColumnCount(5);
+
+  // Set the column headers
+  QStringList headers;
+  headers << "Keyword"
+          << "Shared Papers"
+          << "Papers"
+          << "Total Citations"
+          << "Z-Score";
+  table->setHorizontalHeaderLabels(headers);
+  table->setSortingEnabled(false);
+
+  // Populate the table, most shared papers first
+  int tableRow = 0;
+  for (const auto &entry : related) {
+    table->setItem(tableRow, 0,
+                   new QTableWidgetItem(
+                       QString::fromStdString(store.word(entry.row))));
+    QTableWidgetItem *sharedItem = new QTableWidgetItem();
+    sharedItem->setData(Qt::EditRole, entry.count);
+    table->setItem(tableRow, 1, sharedItem);
+    QTableWidgetItem *papersItem = new QTableWidgetItem();
+    papersItem->setData(Qt::EditRole,
+                        static_cast<qlonglong>(store.nPapers(entry.row)));
+    table->setItem(tableRow, 2, papersItem);
+    QTableWidgetItem *citationItem = new QTableWidgetItem();
+    citationItem->setData(
+        Qt::EditRole, static_cast<qlonglong>(store.totalCitations(entry.row)));
+    table->setItem(tableRow, 3, citationItem);
+    QTableWidgetItem *zScoreItem = new QTableWidgetItem();
+    zScoreItem->setData(Qt::EditRole, store.zScore(entry.row));
+    table->setItem(tableRow, 4, zScoreItem);
+    tableRow++;
+  }
+  table->setSortingEnabled(true);
+
+  // Adjust table properties
+  table->resizeColumnsToContents();
+  table->setEditTriggers(QAbstractItemView::NoEditTriggers);  // Disable editing
+
+  // Create a new QWidget for the tab
+  QWidget *tab = new QWidget();
+  QVBoxLayout *layout = new QVBoxLayout();
+  layout->addWidget(table);
+  tab->setLayout(layout);
+
+  // Add the new tab to the tabWidget
+  QString tabTitle = QString::fromStdString("Related keywords: " + keyword);
+  int tabIndex = tabWidget->addTab(tab, tabTitle);
+  tabWidget->setCurrentIndex(tabIndex);
+
+  // Clicking a keyword opens its own related keywords
+  connect(table, &QTableWidget::clicked, this,
+          [this, table](const QModelIndex &index) {
+            if (index.isValid() && index.column() == 0) {
+              openRelatedKeywords(
+                  table->item(index.row(), 0)->text().toStdString());
+            }
+          });
+
+  // conform the reference size
+  increaseSize();
+  decreaseSize();
+}
+
+void MainWindow::openKeywordVariants(const std::string &keyword) {
+  std::vector<std::string> variants = getKeywordVariants(keyword);
+
+  // Create a new QTableWidget for the variants, the canonical keyword first
+  QTableWidget *table = new QTableWidget();
+  table->setRowCount(static_cast<int>(variants.size()) + 1);
+  table->setColumnCount(1);
+  table->setHorizontalHeaderLabels(QStringList() << "Keyword");
+  table->setItem(0, 0, new QTableWidgetItem(QString::fromStdString(keyword)));
+  int tableRow = 1;
+  for (const auto &variant : variants) {
+    table->setItem(tableRow++, 0,
+                   new QTableWidgetItem(QString::fromStdString(variant)));
+  }
+
+  // Adjust table properties
+  table->resizeColumnsToContents();
+  table->setEditTriggers(QAbstractItemView::NoEditTriggers);  // Disable editing
+
+  // Create a new QWidget for the tab
+  QWidget *tab = new QWidget();
+  QVBoxLayout *layout = new QVBoxLayout();
+  layout->addWidget(table);
+  tab->setLayout(layout);
+
+  // Add the new tab to the tabWidget
+  QString tabTitle = QString::fromStdString("Variants: " + keyword);
+  int tabIndex = tabWidget->addTab(tab, tabTitle);
+  tabWidget->setCurrentIndex(tabIndex);
+
+  // conform the reference size
+  increaseSize();
+  decreaseSize();
+}
+
+void MainWindow::openVariantsOfSelectedRows() {
+  QModelIndexList selectedIndexes =
+      keywords_tableView->selectionModel()->selectedRows();
+  for (const QModelIndex &index : selectedIndexes) {
+    QString word = keywordsTab_model->data(index.siblingAtColumn(0)).toString();
+    openKeywordVariants(word.toStdString());
+  }
+}
+
+void MainWindow::openRelatedOfSelectedRows() {
+  QModelIndexList selectedIndexes =
+      keywords_tableView->selectionModel()->selectedRows();
+  for (const QModelIndex &index : selectedIndexes) {
+    QString word = keywordsTab_model->data(index.siblingAtColumn(0)).toString();
+    openRelatedKeywords(word.toStdString());
+  }
+}
@@ -0,0 +1,132 @@
+#include <QHeaderView>
+#include <QTabWidget>
+#include <QTableWidget>
+#include <QTableWidgetItem>
+#include <QVBoxLayout>
+#include <algorithm>
+
+#include "db.hh"
+#include "gui.hh"
+
+// Number of venues compared side by side, the venues with the most papers
+static const size_t maxComparedVenues = 6;
+// Number of keywords compared when no row is selected, the first rows of
+// the keywords table
+static const int maxComparedKeywords = 100;
+
+void MainWindow::updateVenues() {
+  QString selected = venue_comboBox->currentData().toString();
+  QSignalBlocker blocker(venue_comboBox);
+  venue_comboBox->clear();
+  venue_comboBox->addItem("All venues", QString());
+  for (const auto &[venue, nPapers] : getSliceNames(SliceDimension::Venue)) {
+    QString name = QString::fromStdString(venue);
+    venue_comboBox->addItem(
+        QString("%1 (%2)").arg(name).arg(static_cast<qulonglong>(nPapers)),
+        name);
+  }
+  int index = venue_comboBox->findData(selected);
+  venue_comboBox->setCurrentIndex(std::max(index, 0));
+}
+
+bool MainWindow::isVenueSelected() const {
+  return !venue_comboBox->currentData().toString().isEmpty();
+}
+
+const KeywordStore &MainWindow::selectedVenueStore() const {
+  std::string venue = venue_comboBox->currentData().toString().toStdString();
+  return venue.empty() ? getKeywordStore()
+                       : getKeywordSlice(SliceDimension::Venue, venue);
+}
+
+void MainWindow::openVenueComparison() {
+  std::vector<std::pair<std::string, size_t>> venues =
+      getSliceNames(SliceDimension::Venue);
+  if (venues.size() > maxComparedVenues) {
+    venues.resize(maxComparedVenues);
+  }
+  if (venues.empty()) {
+    return;
+  }
+
+  // the selected keywords, or the first ones of the table
+  std::vector<std::string> keywords;
+  QModelIndexList selectedIndexes =
+      keywords_tableView->selectionModel()->selectedRows();
+  if (selectedIndexes.empty()) {
+    for (int row = 0;
+         row < std::min(keywordsTab_model->rowCount(), maxComparedKeywords);
+         row++) {
+      selectedIndexes << keywordsTab_model->index(row, 0);
+    }
+  }
+  for (const QModelIndex &index : selectedIndexes) {
+    keywords.push_back(keywordsTab_model->data(index.siblingAtColumn(0))
+                           .toString()
+                           .toStdString());
+  }
+
+  // Create a new QTableWidget, the papers, citations and z-score of the
+  // keywords in each venue
+  QTableWidget *table = new QTableWidget();
+  table->setRowCount(static_cast<int>(keywords.size()));
+  table->setColumnCount(1 + 3 * static_cast<int>(venues.size()));
+
+  // Set the column headers
+  QStringList headers;
+  headers << "Keyword";
+  for (const auto &venue : venues) {
+    QString name = QString::fromStdString(venue.first);
+    headers << name + " Papers" << name + " Citations" << name + " Z-Score";
+  }
+  table->setHorizontalHeaderLabels(headers);
+  table->setSortingEnabled(false);
+
+  // Populate the table, a keyword absent from a venue has no papers there
+  for (size_t i = 0; i < keywords.size(); i++) {
+    int tableRow = static_cast<int>(i);
+    table->setItem(tableRow, 0,
+                   new QTableWidgetItem(QString::fromStdString(keywords[i])));
+    for (size_t j = 0; j < venues.size(); j++) {
+      const KeywordStore &slice =
+          getKeywordSlice(SliceDimension::Venue, venues[j].first);
+      KeywordStore::Row row = slice.find(keywords[i]);
+      bool found = row != KeywordStore::npos;
+      int column = 1 + 3 * static_cast<int>(j);
+      QTableWidgetItem *papersItem = new QTableWidgetItem();
+      papersItem->setData(
+          Qt::EditRole,
+          static_cast<qlonglong>(found ? slice.nPapers(row) : 0));
+      table->setItem(tableRow, column, papersItem);
+      QTableWidgetItem *citationItem = new QTableWidgetItem();
+      citationItem->setData(
+          Qt::EditRole,
+          static_cast<qlonglong>(found ? slice.totalCitations(row) : 0));
+      table->setItem(tableRow, column + 1, citationItem);
+      if (found) {
+        QTableWidgetItem *zScoreItem = new QTableWidgetItem();
+        zScoreItem->setData(Qt::EditRole, slice.zScore(row));
+        table->setItem(tableRow, column + 2, zScoreItem);
+      }
+    }
+  }
+  table->setSortingEnabled(true);
+
+  // Adjust table properties
+  table->resizeColumnsToContents();
+  table->setEditTriggers(QAbstractItemView::NoEditTriggers);  // Disable editing
+
+  // Create a new QWidget for the tab
+  QWidget *tab = new QWidget();
+  QVBoxLayout *layout = new QVBoxLayout();
+  layout->addWidget(table);
+  tab->setLayout(layout);
+
+  // Add the new tab to the tabWidget
+  int tabIndex = tabWidget->addTab(tab, "Venues");
+  tabWidget->setCurrentIndex(tabIndex);
+
+  // conform the reference size
+  increaseSize();
+  decreaseSize();
+}
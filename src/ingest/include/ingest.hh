@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "db.hh"
+
+// Inserts the papers of the .bib files into the database, or into the shard
+// of their dataset with --shard-per-dataset
+void ingestBibFiles(const std::vector<std::string>& bibFiles);
+
+// Same as ingestBibFiles, but the files are split among nWorkers forked
+// processes, each one parsing its files into temporary databases; the
+// temporary databases are then merged into the main database (or shards)
+// skipping the DOIs that are already stored
+void ingestBibFilesParallel(const std::vector<std::string>& bibFiles,
+                            size_t nWorkers);
+
+struct IngestProgress {
+  std::string bibFile;
+  // files completed and files queued so far
+  size_t filesDone = 0;
+  size_t filesTotal = 0;
+  // entries of the current file
+  size_t entriesDone = 0;
+  size_t entriesTotal = 0;
+  size_t papersInserted = 0;
+};
+
+// Ingests .bib files on a background thread with its own writer connections,
+// while the thread that owns the main connection (the GUI) keeps querying.
+// Papers are committed in batches; after each batch the statistics of its
+// keywords are handed to onBatch, to be merged with mergeIntoKeywordStore.
+// The callbacks run on the background thread.
+class BackgroundIngest {
+ public:
+  using ProgressCallback = std::function<void(const IngestProgress&)>;
+  using BatchCallback = std::function<void(const KeywordDelta&)>;
+  using FinishedCallback = std::function<void()>;
+
+  BackgroundIngest(ProgressCallback onProgress, BatchCallback onBatch,
+                   FinishedCallback onFinished);
+  // Waits for the file being ingested, the rest of the queue is dropped
+  ~BackgroundIngest();
+
+  // Queues the files and starts the background thread if idle; must be called
+  // from the thread owning the main connection, since it may create shards
+  void enqueue(const std::vector<std::string>& bibFiles);
+
+  bool isRunning() const;
+
+ private:
+  struct Job {
+    std::string bibFile;
+    // path of the database (or shard) receiving the papers
+    std::string targetPath;
+    // paths of all the databases, to skip papers already stored
+    std::vector<std::string> databasePaths;
+  };
+
+  void run();
+  void ingest(const Job& job);
+  SQLite::Database& getConnection(const std::string& path);
+
+  ProgressCallback _onProgress;
+  BatchCallback _onBatch;
+  FinishedCallback _onFinished;
+
+  mutable std::mutex _mutex;
+  std::condition_variable _jobQueued;
+  std::deque<Job> _jobs;
+  bool _busy = false;
+  std::atomic<bool> _stop{false};
+  IngestProgress _progress;
+
+  // used only by the background thread, keyed by path
+  std::map<std::string, std::unique_ptr<SQLite::Database>> _connections;
+
+  // last, it starts running once the members above are constructed
+  std::thread _thread;
+};
@@ -0,0 +1,401 @@
+#include "ingest.hh"
+
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <iostream>
+
+#include "DBPayload.hh"
+#include "bibParser.hh"
+#include "bibtexentry.hpp"
+#include "db.hh"
+#include "globals.hh"
+#include "message.hh"
+
+// Number of papers committed together by the background ingest
+static const size_t batchSize = 256;
+
+// Tables copied from the temporary databases, the paper table first
+static const std::vector<std::string> paperTables = {
+    "paper",                "citations",         "index_term_paper",
+    "author_keyword_paper", "area_paper",        "author_paper",
+    "country_paper",        "institution_paper", "venue_paper"};
+
+// Statements copying a table from the attached temporary database. The ids
+// of the interned names (authors, countries, institutions, venues) are local
+// to each database, they are matched by name
+static std::vector<std::string> mergeStatements(const std::string& table) {
+  if (table == "author_paper") {
+    return {
+        "INSERT OR IGNORE INTO main.author (name) SELECT name FROM "
+        "part.author WHERE id IN (SELECT author_id FROM part.author_paper)",
+        "INSERT OR IGNORE INTO main.author_paper SELECT main.author.id, "
+        "link.doi, link.position FROM part.author_paper AS link "
+        "JOIN part.author AS part_author ON part_author.id = link.author_id "
+        "JOIN main.author ON main.author.name = part_author.name"};
+  }
+  if (table == "country_paper") {
+    // the country of an institution is linked to its papers too
+    return {
+        "INSERT OR IGNORE INTO main.country (name) SELECT name FROM "
+        "part.country WHERE id IN (SELECT country_id FROM part.country_paper)",
+        "INSERT OR IGNORE INTO main.country_paper SELECT main.country.id, "
+        "link.doi FROM part.country_paper AS link "
+        "JOIN part.country AS part_country ON part_country.id = "
+        "link.country_id "
+        "JOIN main.country ON main.country.name = part_country.name"};
+  }
+  if (table == "venue_paper") {
+    return {
+        "INSERT OR IGNORE INTO main.venue (name) SELECT name FROM "
+        "part.venue WHERE id IN (SELECT venue_id FROM part.venue_paper)",
+        "INSERT OR IGNORE INTO main.venue_paper SELECT main.venue.id, "
+        "link.doi FROM part.venue_paper AS link "
+        "JOIN part.venue AS part_venue ON part_venue.id = link.venue_id "
+        "JOIN main.venue ON main.venue.name = part_venue.name"};
+  }
+  if (table == "institution_paper") {
+    const std::string partInstitution =
+        " FROM part.institution AS part_institution "
+        "JOIN part.country AS part_country ON part_country.id = "
+        "part_institution.country_id "
+        "JOIN main.country ON main.country.name = part_country.name";
+    return {
+        "INSERT OR IGNORE INTO main.institution (name, country_id) "
+        "SELECT part_institution.name, main.country.id" +
+            partInstitution +
+            " WHERE part_institution.id IN "
+            "(SELECT institution_id FROM part.institution_paper)",
+        "INSERT OR IGNORE INTO main.institution_paper SELECT "
+        "main.institution.id, link.doi FROM part.institution_paper AS link "
+        "JOIN part.institution AS part_institution ON part_institution.id = "
+        "link.institution_id "
+        "JOIN part.country AS part_country ON part_country.id = "
+        "part_institution.country_id "
+        "JOIN main.country ON main.country.name = part_country.name "
+        "JOIN main.institution ON main.institution.name = "
+        "part_institution.name AND main.institution.country_id = "
+        "main.country.id"};
+  }
+  return {"INSERT OR IGNORE INTO main." + table + " SELECT * FROM part." +
+          table};
+}
+
+static SQLite::Database& getIngestTarget(const std::string& bibFile) {
+  return clc::shardPerDataset ? getShard(getDatasetName(bibFile)) : db;
+}
+
+static std::string getPartPath(size_t fileIndex) {
+  return clc::dbFile + ".part" + std::to_string(fileIndex);
+}
+
+void ingestBibFiles(const std::vector<std::string>& bibFiles) {
+  for (auto& bf : bibFiles) {
+    SQLite::Database& target = getIngestTarget(bf);
+    auto bev = parseBib(bf);
+    std::vector<DBPayload> inserted;
+    for (bibtex::BibTeXEntry& e : bev) {
+      DBPayload payload = toDBPayload(e);
+      if (payload.doi != "" && !paperExists(payload.doi) &&
+          insertPaper(payload, target)) {
+        inserted.push_back(std::move(payload));
+      }
+    }
+    // keeps the cached keywords up to date, if computed already
+    mergeIntoKeywordStore(keywordsOfPapers(inserted));
+  }
+}
+
+// Runs in a worker process: parses a .bib file into a new temporary database.
+// Only the temporary database can be used here, the connections of the
+// parent process must not be touched after the fork
+static void buildPartialDB(const std::string& bibFile,
+                           const std::string& partPath) {
+  std::filesystem::remove(partPath);
+  SQLite::Database part(partPath, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+  // the file is thrown away if anything goes wrong
+  part.exec("PRAGMA journal_mode = OFF; PRAGMA synchronous = OFF;");
+  createTables(part);
+
+  SQLite::Statement exists(part, "SELECT 1 FROM paper WHERE doi = ?");
+  auto bev = parseBib(bibFile);
+  // one transaction for the file, not one per paper
+  SQLite::Transaction transaction(part);
+  for (bibtex::BibTeXEntry& e : bev) {
+    DBPayload payload = toDBPayload(e);
+    if (payload.doi == "") {
+      continue;
+    }
+    exists.bind(1, payload.doi);
+    bool repeated = exists.executeStep();
+    exists.reset();
+    if (!repeated) {
+      insertPaper(payload, part);
+    }
+  }
+  transaction.commit();
+}
+
+static void attachPart(SQLite::Database& database,
+                       const std::string& partPath) {
+  SQLite::Statement attach(database, "ATTACH DATABASE ? AS part");
+  attach.bind(1, partPath);
+  attach.exec();
+}
+
+// Drops from the attached temporary database the papers stored in the main
+// database of the connection, one statement per table
+static void dropStoredPapers(SQLite::Database& database) {
+  for (const auto& table : paperTables) {
+    database.exec("DELETE FROM part." + table +
+                  " WHERE doi IN (SELECT doi FROM main.paper)");
+  }
+}
+
+// Moves the content of a temporary database into the target database, the
+// papers already stored in any database are dropped so that the first
+// occurrence wins, as in ingestBibFiles
+static void mergePartialDB(const std::string& partPath,
+                           SQLite::Database& target) {
+  std::string error;
+  // the papers of the other databases are dropped through their own
+  // connections, those of the target in the transaction of the merge
+  for (SQLite::Database* database : getDatabases()) {
+    if (database == &target || !error.empty()) {
+      continue;
+    }
+    attachPart(*database, partPath);
+    try {
+      SQLite::Transaction transaction(*database);
+      dropStoredPapers(*database);
+      transaction.commit();
+    } catch (const std::exception& e) {
+      error = e.what();
+    }
+    database->exec("DETACH DATABASE part");
+  }
+
+  if (error.empty()) {
+    attachPart(target, partPath);
+    try {
+      SQLite::Transaction transaction(target);
+      dropStoredPapers(target);
+      for (const auto& table : paperTables) {
+        for (const auto& statement : mergeStatements(table)) {
+          target.exec(statement);
+        }
+      }
+      // the variants are not linked to papers, they are all kept
+      target.exec(
+          "INSERT OR IGNORE INTO main.keyword_variant SELECT * FROM "
+          "part.keyword_variant");
+      transaction.commit();
+    } catch (const std::exception& e) {
+      // the transaction is rolled back, nothing of the part is merged
+      error = e.what();
+    }
+    target.exec("DETACH DATABASE part");
+  }
+  // a part that failed to merge is left on disk for inspection and the other
+  // parts are still merged; the next parallel ingest of its file replaces it
+  if (!error.empty()) {
+    messageWarning("Merging " + partPath + " failed, it is kept: " + error);
+    return;
+  }
+  std::filesystem::remove(partPath);
+}
+
+void ingestBibFilesParallel(const std::vector<std::string>& bibFiles,
+                            size_t nWorkers) {
+  nWorkers = std::min(nWorkers, bibFiles.size());
+  if (nWorkers <= 1) {
+    ingestBibFiles(bibFiles);
+    return;
+  }
+
+  // Map: worker w parses the files w, w + nWorkers, ...
+  std::vector<pid_t> workers;
+  for (size_t w = 0; w < nWorkers; w++) {
+    pid_t pid = fork();
+    messageErrorIf(pid == -1, "Fork failed");
+    if (pid == 0) {
+      int status = EXIT_SUCCESS;
+      try {
+        for (size_t i = w; i < bibFiles.size(); i += nWorkers) {
+          buildPartialDB(bibFiles[i], getPartPath(i));
+        }
+      } catch (const std::exception& e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        status = EXIT_FAILURE;
+      }
+      // skip the destructors of the objects inherited from the parent
+      _exit(status);
+    }
+    workers.push_back(pid);
+  }
+
+  bool failed = false;
+  for (pid_t pid : workers) {
+    int status;
+    waitpid(pid, &status, 0);
+    failed |= !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS;
+  }
+  if (failed) {
+    for (size_t i = 0; i < bibFiles.size(); i++) {
+      std::filesystem::remove(getPartPath(i));
+    }
+    messageError("Ingest worker failed");
+  }
+
+  // Reduce: merge in the order of the files
+  for (size_t i = 0; i < bibFiles.size(); i++) {
+    messageInfo("Merging " + bibFiles[i]);
+    mergePartialDB(getPartPath(i), getIngestTarget(bibFiles[i]));
+  }
+}
+
+BackgroundIngest::BackgroundIngest(ProgressCallback onProgress,
+                                   BatchCallback onBatch,
+                                   FinishedCallback onFinished)
+    : _onProgress(std::move(onProgress)),
+      _onBatch(std::move(onBatch)),
+      _onFinished(std::move(onFinished)),
+      _thread(&BackgroundIngest::run, this) {}
+
+BackgroundIngest::~BackgroundIngest() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+    _jobs.clear();
+  }
+  _jobQueued.notify_one();
+  _thread.join();
+}
+
+void BackgroundIngest::enqueue(const std::vector<std::string>& bibFiles) {
+  std::vector<Job> jobs;
+  for (const auto& bf : bibFiles) {
+    Job job;
+    job.bibFile = bf;
+    job.targetPath = getIngestTarget(bf).getFilename();
+    jobs.push_back(job);
+  }
+  // after getIngestTarget, which may have opened new shards
+  std::vector<std::string> databasePaths;
+  for (SQLite::Database* database : getDatabases()) {
+    databasePaths.push_back(database->getFilename());
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& job : jobs) {
+      job.databasePaths = databasePaths;
+      _jobs.push_back(std::move(job));
+      _progress.filesTotal++;
+    }
+  }
+  _jobQueued.notify_one();
+}
+
+bool BackgroundIngest::isRunning() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _busy || !_jobs.empty();
+}
+
+SQLite::Database& BackgroundIngest::getConnection(const std::string& path) {
+  auto& connection = _connections[path];
+  if (connection == nullptr) {
+    connection = openConnection(path);
+  }
+  return *connection;
+}
+
+void BackgroundIngest::run() {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _jobQueued.wait(lock, [this] { return _stop || !_jobs.empty(); });
+      if (_stop) {
+        break;
+      }
+      job = std::move(_jobs.front());
+      _jobs.pop_front();
+      _busy = true;
+    }
+
+    try {
+      ingest(job);
+    } catch (const std::exception& e) {
+      std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    bool finished;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _busy = false;
+      _progress.filesDone++;
+      finished = _jobs.empty();
+    }
+    if (finished) {
+      _onFinished();
+    }
+  }
+  _connections.clear();
+}
+
+void BackgroundIngest::ingest(const Job& job) {
+  SQLite::Database& target = getConnection(job.targetPath);
+  std::vector<SQLite::Database*> databases;
+  for (const auto& path : job.databasePaths) {
+    databases.push_back(&getConnection(path));
+  }
+
+  auto bev = parseBib(job.bibFile);
+  IngestProgress progress;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _progress.bibFile = job.bibFile;
+    _progress.entriesDone = 0;
+    _progress.entriesTotal = bev.size();
+    progress = _progress;
+  }
+  _onProgress(progress);
+
+  auto it = bev.begin();
+  while (it != bev.end()) {
+    if (_stop) {
+      return;
+    }
+    // the batch is committed at once, so readers never see half of it
+    std::vector<DBPayload> inserted;
+    size_t entries = 0;
+    {
+      SQLite::Transaction transaction(target);
+      for (; it != bev.end() && inserted.size() < batchSize; ++it, entries++) {
+        DBPayload payload = toDBPayload(*it);
+        if (payload.doi != "" && !paperExists(payload.doi, databases) &&
+            insertPaper(payload, target)) {
+          inserted.push_back(std::move(payload));
+        }
+      }
+      transaction.commit();
+    }
+
+    // the delta of the keywords is computed from the payloads, in time
+    // proportional to the batch and not to the database
+    if (!inserted.empty()) {
+      _onBatch(keywordsOfPapers(inserted));
+    }
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _progress.entriesDone += entries;
+      _progress.papersInserted += inserted.size();
+      progress = _progress;
+    }
+    _onProgress(progress);
+  }
+}
@@ -1,9 +1,12 @@
 #include <assert.h>
+#include <fcntl.h>
 #include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/file.h>
 #include <sys/time.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "globals.hh"
 #include "message.hh"
@@ -24,8 +27,30 @@ std::string NowTime() {
   return result;
 }
 
+// Keeps other processes (e.g. ingest workers) from rewriting the same log
+// file at the same time
+class LogFileLock {
+public:
+  LogFileLock(const std::string &filename)
+      : _fd(open(filename.c_str(), O_RDWR | O_CREAT, 0644)) {
+    if (_fd != -1) {
+      flock(_fd, LOCK_EX);
+    }
+  }
+  ~LogFileLock() {
+    if (_fd != -1) {
+      flock(_fd, LOCK_UN);
+      close(_fd);
+    }
+  }
+
+private:
+  int _fd;
+};
+
 void dumpErrorToFile(std::string message, int custom_errno,
                      int custom_signal, bool withException) {
+  LogFileLock lock("error.log");
 
   if (!isFileEmpty("error.log")) {
     deleteLastLine("error.log");
@@ -76,6 +101,7 @@ void dumpErrorToFile(std::string message, int custom_errno,
 }
 
 void dumpWarningToFile(std::string message) {
+  LogFileLock lock("warning.log");
 
   if (!isFileEmpty("warning.log")) {
     deleteLastLine("warning.log");
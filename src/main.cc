@@ -13,6 +13,7 @@
 #include "db.hh"
 #include "globals.hh"
 #include "gui.hh"
+#include "ingest.hh"
 #include "message.hh"
 
 /// @brief handle all the command line arguments
@@ -34,21 +35,39 @@ int main(int arg, char *argv[]) {
 
   parseCommandLineArguments(arg, argv);
 
+  // creates the database if needed and opens it
   createDB();
-  openDB();
 
+  // The GUI ingests the files in the background and opens immediately. The
+  // worker processes are forked before any thread is started
+  bool noGui = !clc::query.empty() || clc::burstsSince > 0 ||
+               !clc::expression.empty() || clc::benchmark;
   if (!clc::bibFiles.empty()) {
-    for (auto &bf : clc::bibFiles) {
-      auto bev = parseBib(bf);
-      for (bibtex::BibTeXEntry &e : bev) {
-        DBPayload payload = toDBPayload(e);
-        if (payload.doi != "") {
-          insertPaper(payload);
-        }
-      }
+    if (clc::ingestWorkers > 1) {
+      ingestBibFilesParallel(clc::bibFiles, clc::ingestWorkers);
+      clc::bibFiles.clear();
+    } else if (noGui) {
+      ingestBibFiles(clc::bibFiles);
+      clc::bibFiles.clear();
     }
   }
 
+  if (!clc::query.empty()) {
+    return printQuery(clc::query) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+  if (clc::burstsSince > 0) {
+    printBurstingKeywords(clc::burstsSince);
+    return 0;
+  }
+  if (!clc::expression.empty()) {
+    printKeywordExpression(clc::expression);
+    return 0;
+  }
+  if (clc::benchmark) {
+    benchmarkKeywordPasses();
+    return 0;
+  }
+
   // print welcome message
   // std::cout << getIcon() << "\n";
 
@@ -130,4 +149,37 @@ void parseCommandLineArguments(int argc, char *args[]) {
       clc::bibFiles.push_back(bibPath);
     }
   }
+
+  if (result.count("shard-per-dataset")) {
+    clc::shardPerDataset = true;
+  }
+
+  if (result.count("ingest-workers")) {
+    clc::ingestWorkers = result["ingest-workers"].as<size_t>();
+    messageErrorIf(clc::ingestWorkers == 0,
+                   "The number of ingest workers must be at least 1");
+  }
+
+  if (result.count("query")) {
+    clc::query = result["query"].as<std::string>();
+  }
+
+  if (result.count("bursts")) {
+    clc::burstsSince = result["bursts"].as<size_t>();
+    messageErrorIf(clc::burstsSince == 0, "The burst year must be positive");
+  }
+
+  if (result.count("synonyms")) {
+    clc::synonymsFile = result["synonyms"].as<std::string>();
+    messageErrorIf(!std::filesystem::exists(clc::synonymsFile),
+                   "Can not find synonym file '" + clc::synonymsFile + "'");
+  }
+
+  if (result.count("expression")) {
+    clc::expression = result["expression"].as<std::string>();
+  }
+
+  if (result.count("benchmark")) {
+    clc::benchmark = true;
+  }
 }
@@ -460,6 +460,10 @@ inline void deleteLastLine(const std::string &filename) {
   // Close the input file
   inputFile.close();
 
+  if (lines.empty()) {
+    return;
+  }
+
   // Open the file for writing
   std::ofstream outputFile(filename);
   if (!outputFile.is_open()) {
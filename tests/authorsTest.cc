@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "DBPayload.hh"
+#include "db.hh"
+#include "globals.hh"
+#include "ingest.hh"
+
+namespace {
+const size_t nAuthors = 40;
+
+std::string authorName(size_t i) {
+  return "Author" + std::to_string(i) + ", " + char('A' + i % 26) + ".";
+}
+
+// Papers with a few authors of a small pool, the first ones more frequent,
+// and citations over a few years
+std::vector<DBPayload> randomPapers(std::mt19937& rng, const std::string& prefix,
+                                    size_t nPapers) {
+  std::uniform_int_distribution<size_t> anyAuthor(0, nAuthors - 1);
+  std::uniform_int_distribution<size_t> nPaperAuthors(1, 5);
+  std::uniform_int_distribution<int> year(2015, 2020);
+  std::uniform_int_distribution<int> citations(0, 9);
+  std::vector<DBPayload> papers;
+  for (size_t p = 0; p < nPapers; p++) {
+    DBPayload paper;
+    paper.doi = prefix + std::to_string(p);
+    paper.title = "Paper " + paper.doi;
+    paper.year = year(rng);
+    for (size_t a = nPaperAuthors(rng); a > 0; a--) {
+      paper.authors_list += (paper.authors_list.empty() ? "" : " and ") +
+                            authorName(std::min(anyAuthor(rng), anyAuthor(rng)));
+    }
+    for (int y = paper.year; y <= 2022; y++) {
+      paper.citations.emplace_back(y, citations(rng));
+      paper.total_citations += paper.citations.back().second;
+    }
+    papers.push_back(paper);
+  }
+  return papers;
+}
+
+void writeBib(const std::string& path, const std::vector<DBPayload>& papers) {
+  std::ofstream out(path);
+  for (const auto& paper : papers) {
+    std::string citations;
+    for (const auto& [year, number] : paper.citations) {
+      citations += (citations.empty() ? "" : ",") + std::to_string(year) +
+                   ":" + std::to_string(number);
+    }
+    out << "@article{" << paper.doi << ",\n"
+        << " author = {" << paper.authors_list << "},\n"
+        << " doi = {" << paper.doi << "},\n"
+        << " per_year_citations = {" << citations << "},\n"
+        << " title = {" << paper.title << "},\n"
+        << " year = {" << paper.year << "}\n"
+        << "}\n\n";
+  }
+}
+
+// (author, doi, position) links of a database file, sorted
+std::vector<std::tuple<std::string, std::string, int>> authorLinks(
+    const std::string& path) {
+  SQLite::Database database(path, SQLite::OPEN_READONLY);
+  SQLite::Statement query(database,
+                          "SELECT author.name, author_paper.doi, "
+                          "author_paper.position FROM author_paper JOIN "
+                          "author ON author.id = author_paper.author_id "
+                          "ORDER BY 1, 2");
+  std::vector<std::tuple<std::string, std::string, int>> links;
+  while (query.executeStep()) {
+    links.emplace_back(query.getColumn(0).getString(),
+                       query.getColumn(1).getString(),
+                       query.getColumn(2).getInt());
+  }
+  return links;
+}
+}  // namespace
+
+TEST(AuthorsTest, SplitAuthors) {
+  EXPECT_EQ(splitAuthors("Last, F. and Other, G."),
+            (std::vector<std::string>{"Last, F.", "Other, G."}));
+  EXPECT_EQ(splitAuthors("  Last,   F.  and others"),
+            (std::vector<std::string>{"Last, F."}));
+  EXPECT_EQ(splitAuthors("Sand, A. and Andersen, B."),
+            (std::vector<std::string>{"Sand, A.", "Andersen, B."}));
+  EXPECT_TRUE(splitAuthors("").empty());
+}
+
+// The author statistics against the sums of the linked papers in SQL, on the
+// in-memory database
+TEST(AuthorsTest, StatisticsMatchSQLSums) {
+  std::mt19937 rng(1);
+  createTables(db);
+  for (const auto& paper : randomPapers(rng, "10.1/stats.", 400)) {
+    ASSERT_TRUE(insertPaper(paper, db));
+  }
+
+  const KeywordStore& store = getAuthorStore();
+  SQLite::Statement query(
+      db,
+      "SELECT author.name, count(*), sum(paper.total_citations) FROM "
+      "author_paper JOIN author ON author.id = author_paper.author_id JOIN "
+      "paper ON paper.doi = author_paper.doi GROUP BY author.id");
+  size_t nAuthorsFound = 0;
+  while (query.executeStep()) {
+    std::string name = query.getColumn(0).getString();
+    KeywordStore::Row row = store.find(name);
+    ASSERT_NE(row, KeywordStore::npos) << name;
+    EXPECT_EQ(store.nPapers(row), size_t(query.getColumn(1).getInt64()));
+    EXPECT_EQ(store.totalCitations(row),
+              uint64_t(query.getColumn(2).getInt64()));
+    SQLite::Statement years(
+        db,
+        "SELECT citations.year, sum(citations.number) FROM author_paper JOIN "
+        "author ON author.id = author_paper.author_id JOIN citations ON "
+        "citations.doi = author_paper.doi WHERE author.name = ? GROUP BY "
+        "citations.year");
+    years.bind(1, name);
+    while (years.executeStep()) {
+      EXPECT_EQ(store.citations(row, years.getColumn(0).getInt()),
+                uint32_t(years.getColumn(1).getInt()));
+    }
+    nAuthorsFound++;
+  }
+  EXPECT_EQ(store.nKeywords(), nAuthorsFound);
+
+  // the prefix search finds all the names with the prefix, most cited first
+  for (const std::string prefix : {"author1", "AUTHOR2", "Author", "x"}) {
+    KeywordSearchResult result =
+        searchAuthors(prefix, KeywordOrder::Citations, true, nAuthors);
+    std::vector<std::pair<uint64_t, std::string>> expected;
+    for (KeywordStore::Row row = 0; row < store.size(); row++) {
+      std::string name = store.word(row);
+      if (strncasecmp(name.c_str(), prefix.c_str(), prefix.size()) == 0) {
+        expected.emplace_back(store.totalCitations(row), name);
+      }
+    }
+    EXPECT_EQ(result.nMatches, expected.size()) << prefix;
+    ASSERT_EQ(result.rows.size(), expected.size()) << prefix;
+    std::sort(expected.rbegin(), expected.rend());
+    for (size_t i = 0; i < expected.size(); i++) {
+      EXPECT_EQ(store.totalCitations(result.rows[i]), expected[i].first);
+    }
+  }
+}
+
+// The authors of the workers' databases have their own ids, the merge
+// matches them by name
+TEST(AuthorsTest, ParallelIngestLinksMatchSequential) {
+  std::mt19937 rng(2);
+  auto dir = std::filesystem::temp_directory_path() / "circusAuthorsTest";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+
+  // the files share a few papers, the first occurrence wins
+  std::vector<DBPayload> papers = randomPapers(rng, "10.1/ingest.", 160);
+  std::vector<std::string> bibFiles;
+  for (size_t f = 0; f < 3; f++) {
+    std::vector<DBPayload> filePapers(papers.begin() + f * 50,
+                                      papers.begin() + f * 50 + 60);
+    bibFiles.push_back((dir / ("f" + std::to_string(f) + ".bib")).string());
+    writeBib(bibFiles.back(), filePapers);
+  }
+
+  // the parallel ingest first: its workers parse the files, so the entries
+  // are not reported as repeated by the sequential one
+  clc::dbFile = (dir / "parallel.db").string();
+  createDB();
+  ingestBibFilesParallel(bibFiles, 3);
+  clc::dbFile = (dir / "sequential.db").string();
+  createDB();
+  ingestBibFiles(bibFiles);
+
+  auto links = authorLinks((dir / "sequential.db").string());
+  EXPECT_FALSE(links.empty());
+  EXPECT_EQ(authorLinks((dir / "parallel.db").string()), links);
+  db = SQLite::Database(":memory:", SQLite::OPEN_READWRITE);
+  std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "keywordBursts.hh"
+
+namespace {
+const size_t firstYear = 2010;
+const size_t nYears = 8;
+
+// Cost of a state sequence of a series, as defined by KeywordBursts: the
+// emissions of each year and the cost of each entry into the burst state
+double pathCost(const std::vector<bool>& inBurst,
+                const std::vector<uint64_t>& values,
+                const std::vector<uint64_t>& totals) {
+  uint64_t sum = 0;
+  uint64_t total = 0;
+  for (size_t t = 0; t < values.size(); t++) {
+    sum += values[t];
+    total += totals[t];
+  }
+  double p0 = static_cast<double>(sum) / total;
+  double p1 = std::min(KeywordBursts::rateRatio * p0, 1 - 1e-9);
+  double up = KeywordBursts::transitionCost * std::log(values.size());
+  double cost = 0;
+  bool previous = false;
+  for (size_t t = 0; t < values.size(); t++) {
+    double p = inBurst[t] ? p1 : p0;
+    cost -=
+        values[t] * std::log(p) + (totals[t] - values[t]) * std::log1p(-p);
+    if (inBurst[t] && !previous) {
+      cost += up;
+    }
+    previous = inBurst[t];
+  }
+  return cost;
+}
+
+// The cheapest state sequence, over all of them
+double bruteForceCost(const std::vector<uint64_t>& values,
+                      const std::vector<uint64_t>& totals) {
+  double best = std::numeric_limits<double>::infinity();
+  for (size_t mask = 0; mask < size_t(1) << values.size(); mask++) {
+    std::vector<bool> inBurst(values.size());
+    for (size_t t = 0; t < values.size(); t++) {
+      inBurst[t] = mask >> t & 1;
+    }
+    best = std::min(best, pathCost(inBurst, values, totals));
+  }
+  return best;
+}
+
+KeywordSummary summary(const std::string& word,
+                       const std::vector<uint64_t>& citations) {
+  KeywordSummary keyword;
+  keyword._word = word;
+  for (size_t t = 0; t < citations.size(); t++) {
+    keyword._yearToCitations[firstYear + t] = citations[t];
+  }
+  return keyword;
+}
+}  // namespace
+
+TEST(KeywordBurstsTest, ViterbiMatchesBruteForce) {
+  std::mt19937 rng(1);
+  for (int i = 0; i < 20; i++) {
+    // a few keywords, some with a jump of their citations
+    KeywordStore store;
+    std::vector<std::vector<uint64_t>> series;
+    for (int k = 0; k < 5; k++) {
+      std::vector<uint64_t> citations(nYears);
+      size_t jump = std::uniform_int_distribution<size_t>(0, nYears - 1)(rng);
+      for (size_t t = 0; t < nYears; t++) {
+        citations[t] = std::uniform_int_distribution<uint64_t>(
+            0, t >= jump && k % 2 == 0 ? 60 : 20)(rng);
+      }
+      store.add(summary("k" + std::to_string(k), citations));
+      series.push_back(citations);
+    }
+    std::vector<uint64_t> totals(nYears, 0);
+    for (const auto& citations : series) {
+      for (size_t t = 0; t < nYears; t++) {
+        totals[t] += citations[t];
+      }
+    }
+
+    KeywordBursts bursts;
+    bursts.compute(store, firstYear + nYears - 1);
+    EXPECT_EQ(bursts.storeVersion(), store.version());
+    for (KeywordStore::Row row = 0; row < store.size(); row++) {
+      // the sequence of the bursts found for the row
+      std::vector<bool> inBurst(nYears, false);
+      for (const auto& burst : bursts.bursts()) {
+        if (burst.row != row || burst.series != KeywordBursts::Citations) {
+          continue;
+        }
+        ASSERT_LE(burst.from, burst.to);
+        std::vector<bool> base = inBurst;
+        for (size_t year = burst.from; year <= burst.to; year++) {
+          ASSERT_FALSE(inBurst[year - firstYear]);
+          inBurst[year - firstYear] = true;
+        }
+        // the intensity is the cost saved by the burst state
+        EXPECT_NEAR(burst.intensity,
+                    pathCost(base, series[row], totals) -
+                        pathCost(inBurst, series[row], totals) +
+                        KeywordBursts::transitionCost * std::log(nYears),
+                    1e-6);
+      }
+      EXPECT_NEAR(pathCost(inBurst, series[row], totals),
+                  bruteForceCost(series[row], totals), 1e-6);
+    }
+  }
+}
+
+TEST(KeywordBurstsTest, SinceSkipsOlderAndRemovedKeywords) {
+  KeywordStore store;
+  store.add(summary("flat", {10, 10, 10, 10, 10, 10, 10, 10}));
+  store.add(summary("late", {1, 1, 1, 1, 1, 1, 30, 30}));
+  store.add(summary("early", {30, 30, 1, 1, 1, 1, 1, 1}));
+  KeywordBursts bursts;
+  bursts.compute(store, firstYear + nYears - 1);
+
+  auto recent = bursts.since(firstYear + 4, KeywordBursts::Citations, store);
+  ASSERT_EQ(recent.size(), 1u);
+  EXPECT_EQ(store.word(recent[0].row), "late");
+  EXPECT_EQ(recent[0].from, firstYear + 6);
+  EXPECT_EQ(recent[0].to, firstYear + 7);
+
+  // a removed keyword has no bursts
+  KeywordStore::Row late = recent[0].row;
+  store.remove(late);
+  EXPECT_TRUE(
+      bursts.since(firstYear + 4, KeywordBursts::Citations, store).empty());
+  bool early = false;
+  for (const auto& burst :
+       bursts.since(firstYear, KeywordBursts::Citations, store)) {
+    EXPECT_NE(burst.row, late);
+    early |= store.word(burst.row) == "early";
+  }
+  EXPECT_TRUE(early);
+}
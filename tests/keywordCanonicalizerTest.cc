@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+
+#include "keywordCanonicalizer.hh"
+
+TEST(KeywordCanonicalizerTest, Plurals) {
+  const std::map<std::string, std::string> singulars = {
+      {"networks", "network"},
+      {"technologies", "technology"},
+      {"switches", "switch"},
+      {"caches", "cache"},
+      // acronym plurals
+      {"gpus", "gpu"},
+      {"cpus", "cpu"},
+      {"npus", "npu"},
+      {"gpgpus", "gpgpu"},
+      {"mcus", "mcu"},
+      {"asics", "asic"},
+      {"fpgas", "fpga"},
+      {"ssds", "ssd"},
+      // irregular plurals
+      {"buses", "bus"},
+      {"viruses", "virus"},
+      {"analyses", "analysis"},
+      {"hypotheses", "hypothesis"},
+  };
+  KeywordCanonicalizer canonicalizer;
+  for (const auto& [plural, singular] : singulars) {
+    EXPECT_EQ(canonicalizer.canonical(plural), singular) << plural;
+    EXPECT_EQ(canonicalizer.canonical(singular), singular) << singular;
+  }
+}
+
+TEST(KeywordCanonicalizerTest, NotPlurals) {
+  KeywordCanonicalizer canonicalizer;
+  for (const std::string word :
+       {"mips", "flops", "cmos", "plus", "bus", "focus", "status", "consensus",
+        "modbus", "corpus", "analysis", "physics", "optics", "electronics",
+        "graphics", "address", "series"}) {
+    EXPECT_EQ(canonicalizer.canonical(word), word);
+  }
+}
+
+TEST(KeywordCanonicalizerTest, Folding) {
+  KeywordCanonicalizer canonicalizer;
+  EXPECT_EQ(canonicalizer.canonical("Multi-Core  CPUs"), "multi core cpu");
+  EXPECT_EQ(canonicalizer.canonical("Field Programmable Gate Arrays (FPGA)"),
+            "field programmable gate array");
+  EXPECT_EQ(canonicalizer.canonical("\"Low_power\" 2.5D/3D Circuits"),
+            "low power 2.5d 3d circuit");
+}
+
+TEST(KeywordCanonicalizerTest, Synonyms) {
+  const std::string path = "keywordCanonicalizerTest.synonyms";
+  {
+    std::ofstream out(path);
+    out << "machine learning, ML, statistical learning # comment\n";
+    out << "graphics processing unit, GPUs\n";
+  }
+  KeywordCanonicalizer canonicalizer;
+  uint64_t rules = canonicalizer.signature();
+  ASSERT_TRUE(canonicalizer.loadSynonyms(path));
+  std::remove(path.c_str());
+  EXPECT_NE(canonicalizer.signature(), rules);
+  EXPECT_EQ(canonicalizer.canonical("ML"), "machine learning");
+  EXPECT_EQ(canonicalizer.canonical("Statistical-Learning"),
+            "machine learning");
+  // the variants are canonicalized before the lookup
+  EXPECT_EQ(canonicalizer.canonical("GPU"), "graphics processing unit");
+  EXPECT_EQ(canonicalizer.canonical("comment"), "comment");
+  EXPECT_FALSE(canonicalizer.loadSynonyms(path));
+}
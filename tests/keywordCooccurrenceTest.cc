@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "keywordCooccurrence.hh"
+#include "paperSet.hh"
+
+namespace {
+using Row = KeywordCooccurrence::Row;
+using Pairs = std::vector<std::pair<KeywordCooccurrence::PaperId, Row>>;
+
+// Keywords of random papers, a few of them much more frequent than the
+// others; some (paper, keyword) pairs are repeated
+std::vector<std::vector<Row>> randomPapers(std::mt19937& rng, size_t nPapers,
+                                           size_t nRows, size_t maxKeywords) {
+  std::uniform_int_distribution<Row> anyRow(0, nRows - 1);
+  std::uniform_int_distribution<size_t> nKeywords(1, maxKeywords);
+  std::vector<std::vector<Row>> papers(nPapers);
+  for (auto& rows : papers) {
+    for (size_t k = nKeywords(rng); k > 0; k--) {
+      rows.push_back(std::min(anyRow(rng), anyRow(rng)));
+    }
+  }
+  return papers;
+}
+
+Pairs toPairs(const std::vector<std::vector<Row>>& papers, size_t end) {
+  Pairs pairs;
+  for (size_t p = 0; p < end; p++) {
+    for (Row row : papers[p]) {
+      pairs.emplace_back(p, row);
+    }
+  }
+  return pairs;
+}
+
+KeywordStore storeOf(size_t nRows) {
+  KeywordStore store;
+  for (Row row = 0; row < nRows; row++) {
+    KeywordSummary keyword;
+    keyword._word = "k" + std::to_string(row);
+    store.add(keyword);
+  }
+  return store;
+}
+
+std::vector<std::pair<Row, uint32_t>> entries(
+    const std::vector<KeywordCooccurrence::Entry>& related) {
+  std::vector<std::pair<Row, uint32_t>> ret;
+  for (const auto& entry : related) {
+    ret.emplace_back(entry.row, entry.count);
+  }
+  return ret;
+}
+}  // namespace
+
+TEST(KeywordCooccurrenceTest, MatchesPaperSetIntersections) {
+  const size_t nRows = 300;
+  std::mt19937 rng(1);
+  auto papers = randomPapers(rng, 5000, nRows, 6);
+  KeywordStore store = storeOf(nRows);
+  KeywordCooccurrence cooccurrence;
+  cooccurrence.build(toPairs(papers, papers.size()), nRows);
+
+  std::vector<std::vector<PaperSet::Id>> rowPapers(nRows);
+  for (size_t p = 0; p < papers.size(); p++) {
+    for (Row row : papers[p]) {
+      if (rowPapers[row].empty() || rowPapers[row].back() != p) {
+        rowPapers[row].push_back(p);
+      }
+    }
+  }
+  std::vector<PaperSet> sets;
+  for (const auto& ids : rowPapers) {
+    sets.push_back(PaperSet::fromSorted(ids));
+  }
+
+  for (Row a = 0; a < nRows; a++) {
+    // decreasing count, then increasing row
+    std::vector<std::pair<Row, uint32_t>> expected;
+    for (Row b = 0; b < nRows; b++) {
+      uint32_t shared = a == b ? 0 : (sets[a] & sets[b]).cardinality();
+      EXPECT_EQ(cooccurrence.sharedPapers(a, b), shared) << a << " " << b;
+      if (shared > 0) {
+        expected.emplace_back(b, shared);
+      }
+    }
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](const auto& x, const auto& y) {
+                       return x.second > y.second;
+                     });
+    EXPECT_EQ(entries(cooccurrence.related(a, nRows, store)), expected) << a;
+    expected.resize(std::min<size_t>(expected.size(), 5));
+    EXPECT_EQ(entries(cooccurrence.related(a, 5, store)), expected) << a;
+  }
+
+  // a removed keyword is not related to any other
+  Row removed = cooccurrence.related(0, 1, store).front().row;
+  store.remove(removed);
+  for (const auto& entry : cooccurrence.related(0, nRows, store)) {
+    EXPECT_NE(entry.row, removed);
+  }
+}
+
+TEST(KeywordCooccurrenceTest, IncrementalEqualsFullBuild) {
+  // enough new pairs to fold the delta into the rows, and new keywords
+  // after the build
+  const size_t nBuildRows = 1500;
+  const size_t nRows = 2000;
+  std::mt19937 rng(2);
+  auto papers = randomPapers(rng, 6000, nRows, 12);
+  for (size_t p = 0; p < papers.size() / 2; p++) {
+    for (Row& row : papers[p]) {
+      row %= nBuildRows;
+    }
+  }
+  KeywordStore store = storeOf(nRows);
+
+  KeywordCooccurrence incremental;
+  incremental.build(toPairs(papers, papers.size() / 2), nBuildRows);
+  for (size_t p = papers.size() / 2; p < papers.size(); p++) {
+    incremental.addPaper(papers[p]);
+    if (p % 1000 != 999 && p + 1 != papers.size()) {
+      continue;
+    }
+    KeywordCooccurrence full;
+    full.build(toPairs(papers, p + 1), nRows);
+    for (Row row = 0; row < nRows; row++) {
+      auto related = entries(full.related(row, nRows, store));
+      ASSERT_EQ(entries(incremental.related(row, nRows, store)), related)
+          << p << " " << row;
+      for (const auto& [other, count] : related) {
+        ASSERT_EQ(incremental.sharedPapers(row, other), count);
+      }
+    }
+  }
+}
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "keywordExpression.hh"
+
+namespace {
+const size_t nPapers = 20;
+
+using Ids = std::set<PaperSet::Id>;
+
+// Papers of the keywords of the expressions below
+const std::map<std::string, Ids> keywordPapers = {
+    {"a", {0, 1, 2, 3, 4, 5, 6, 7}},
+    {"b", {4, 5, 6, 7, 8, 9, 10, 11}},
+    {"c", {1, 3, 5, 7, 9, 11, 13}},
+    {"neural network", {2, 3, 12, 13, 14}},
+};
+
+Ids unite(const Ids& a, const Ids& b) {
+  Ids ids;
+  std::set_union(a.begin(), a.end(), b.begin(), b.end(),
+                 std::inserter(ids, ids.end()));
+  return ids;
+}
+
+Ids intersect(const Ids& a, const Ids& b) {
+  Ids ids;
+  std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                        std::inserter(ids, ids.end()));
+  return ids;
+}
+
+Ids subtract(const Ids& a, const Ids& b) {
+  Ids ids;
+  std::set_difference(a.begin(), a.end(), b.begin(), b.end(),
+                      std::inserter(ids, ids.end()));
+  return ids;
+}
+
+Ids all() {
+  Ids ids;
+  for (PaperSet::Id id = 0; id < nPapers; id++) {
+    ids.insert(id);
+  }
+  return ids;
+}
+
+// Papers matching an expression, an unknown keyword has none
+Ids evaluate(const std::string& expression) {
+  KeywordExpression parsed;
+  EXPECT_TRUE(parsed.parse(expression)) << expression << ": " << parsed.error();
+  std::vector<PaperSet> papers;
+  for (const std::string& term : parsed.terms()) {
+    auto it = keywordPapers.find(term);
+    Ids ids = it == keywordPapers.end() ? Ids() : it->second;
+    papers.push_back(PaperSet::fromSorted(
+        std::vector<PaperSet::Id>(ids.begin(), ids.end())));
+  }
+  std::vector<const PaperSet*> termPapers;
+  for (const PaperSet& set : papers) {
+    termPapers.push_back(&set);
+  }
+  std::vector<PaperSet::Id> ids =
+      parsed.evaluate(termPapers, nPapers).toVector();
+  return Ids(ids.begin(), ids.end());
+}
+}  // namespace
+
+TEST(KeywordExpressionTest, Terms) {
+  KeywordExpression parsed;
+  ASSERT_TRUE(parsed.parse("\"neural network\" AND (a OR b) NOT a"));
+  EXPECT_EQ(parsed.terms(),
+            (std::vector<std::string>{"neural network", "a", "b"}));
+  // the words of a term without quotes are one keyword
+  ASSERT_TRUE(parsed.parse("neural network OR c"));
+  EXPECT_EQ(parsed.terms(), (std::vector<std::string>{"neural network", "c"}));
+  EXPECT_EQ(evaluate("neural network OR c"),
+            unite(keywordPapers.at("neural network"), keywordPapers.at("c")));
+}
+
+TEST(KeywordExpressionTest, Precedence) {
+  const Ids& a = keywordPapers.at("a");
+  const Ids& b = keywordPapers.at("b");
+  const Ids& c = keywordPapers.at("c");
+  // AND binds tighter than OR
+  EXPECT_EQ(evaluate("a OR b AND c"), unite(a, intersect(b, c)));
+  EXPECT_EQ(evaluate("a AND b OR c"), unite(intersect(a, b), c));
+  EXPECT_EQ(evaluate("(a OR b) AND c"), intersect(unite(a, b), c));
+  // NOT after a term is AND NOT, tighter than OR as well
+  EXPECT_EQ(evaluate("a OR b NOT c"), unite(a, subtract(b, c)));
+  EXPECT_EQ(evaluate("a NOT b NOT c"), subtract(subtract(a, b), c));
+}
+
+TEST(KeywordExpressionTest, AndNot) {
+  const Ids& a = keywordPapers.at("a");
+  const Ids& b = keywordPapers.at("b");
+  EXPECT_EQ(evaluate("a AND NOT b"), subtract(a, b));
+  EXPECT_EQ(evaluate("a NOT b"), subtract(a, b));
+  EXPECT_EQ(evaluate("a AND NOT unknown"), a);
+  EXPECT_EQ(evaluate("unknown OR a"), a);
+}
+
+TEST(KeywordExpressionTest, LeadingNot) {
+  const Ids& a = keywordPapers.at("a");
+  const Ids& b = keywordPapers.at("b");
+  // the complement in all the papers
+  EXPECT_EQ(evaluate("NOT a"), subtract(all(), a));
+  EXPECT_EQ(evaluate("NOT a AND b"), intersect(subtract(all(), a), b));
+  EXPECT_EQ(evaluate("NOT (a OR b)"), subtract(all(), unite(a, b)));
+  EXPECT_EQ(evaluate("NOT NOT a"), a);
+  EXPECT_EQ(evaluate("NOT unknown"), all());
+}
+
+TEST(KeywordExpressionTest, Errors) {
+  const std::map<std::string, std::string> errors = {
+      {"a AND \"neural", "unterminated quote"},
+      {"(a OR b", "missing ')'"},
+      {"a AND", "keyword expected"},
+      {"NOT", "keyword expected"},
+      {"a OR ()", "keyword expected"},
+      {"", "keyword expected"},
+      {"a OR b)", "unexpected ')'"},
+      {"\"a\" \"b\"", "operator expected"},
+  };
+  for (const auto& [expression, error] : errors) {
+    KeywordExpression parsed;
+    EXPECT_FALSE(parsed.parse(expression)) << expression;
+    EXPECT_EQ(parsed.error(), error) << expression;
+    EXPECT_TRUE(parsed.terms().empty()) << expression;
+  }
+  // a valid expression clears the error of the previous one
+  KeywordExpression parsed;
+  EXPECT_FALSE(parsed.parse("a AND"));
+  EXPECT_TRUE(parsed.parse("a AND b"));
+  EXPECT_TRUE(parsed.error().empty());
+}
+
+TEST(KeywordExpressionTest, HasOperator) {
+  EXPECT_TRUE(KeywordExpression::hasOperator("a AND"));
+  EXPECT_TRUE(KeywordExpression::hasOperator("NOT a"));
+  EXPECT_TRUE(KeywordExpression::hasOperator("a OR b"));
+  // lower case words and quoted operators are keywords
+  EXPECT_FALSE(KeywordExpression::hasOperator("rock and roll"));
+  EXPECT_FALSE(KeywordExpression::hasOperator("\"AND\""));
+  EXPECT_FALSE(KeywordExpression::hasOperator("neural network"));
+}
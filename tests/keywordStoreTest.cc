@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "dbUtils.hh"
+#include "keywordStore.hh"
+
+namespace {
+const size_t firstYear = 2010;
+const size_t lastYear = 2021;
+// the last year is partial, as the current year of a database
+const size_t refYear = lastYear - 1;
+
+using Series = std::map<size_t, size_t>;
+
+uint64_t sumIn(const Series& series, size_t from, size_t to) {
+  uint64_t sum = 0;
+  for (const auto& [year, value] : series) {
+    sum += year >= from && year <= to ? value : 0;
+  }
+  return sum;
+}
+
+size_t valueIn(const Series& series, size_t year) {
+  auto it = series.find(year);
+  return it == series.end() ? 0 : it->second;
+}
+
+// Keywords with citations over a random span of years, some of them zero,
+// and papers and impact factor citations in the same years
+std::vector<KeywordSummary> randomKeywords(std::mt19937& rng) {
+  std::vector<KeywordSummary> keywords;
+  for (int k = 0; k < 30; k++) {
+    KeywordSummary keyword;
+    keyword._word = "k" + std::to_string(k);
+    size_t from = std::uniform_int_distribution<size_t>(firstYear, 2018)(rng);
+    size_t to = std::uniform_int_distribution<size_t>(from, lastYear)(rng);
+    for (size_t year = from; year <= to; year++) {
+      keyword._yearToCitations[year] =
+          std::uniform_int_distribution<size_t>(0, 3)(rng) == 0
+              ? 0
+              : std::uniform_int_distribution<size_t>(1, 50)(rng);
+      keyword._yearToNewPapers[year] =
+          std::uniform_int_distribution<size_t>(0, 5)(rng);
+      keyword._yearToIFCitations[year] =
+          std::uniform_int_distribution<size_t>(0, 20)(rng);
+    }
+    keywords.push_back(keyword);
+  }
+  return keywords;
+}
+}  // namespace
+
+TEST(KeywordStoreTest, WindowedMetricsMatchBruteForce) {
+  std::mt19937 rng(1);
+  for (int i = 0; i < 5; i++) {
+    std::vector<KeywordSummary> keywords = randomKeywords(rng);
+    KeywordStore store;
+    for (const KeywordSummary& keyword : keywords) {
+      store.add(keyword);
+    }
+    store.computeZScores(refYear);
+    store.computeTrends(refYear);
+
+    for (KeywordStore::Row row = 0; row < store.size(); row++) {
+      const KeywordSummary& keyword = keywords[row];
+      size_t citationFrom = keyword._yearToCitations.begin()->first;
+      size_t citationTo = keyword._yearToCitations.rbegin()->first;
+      // the ranges past the years of the store are clamped
+      for (size_t from = firstYear - 1; from <= lastYear + 1; from++) {
+        for (size_t to = from; to <= lastYear + 1; to++) {
+          YearRange range{from, to};
+          EXPECT_EQ(store.citationsIn(row, range),
+                    sumIn(keyword._yearToCitations, from, to));
+          EXPECT_EQ(store.newPapersIn(row, range),
+                    sumIn(keyword._yearToNewPapers, from, to));
+
+          uint64_t papers = 0;
+          for (size_t year = std::max(from, firstYear);
+               year <= std::min(to, lastYear); year++) {
+            papers += valueIn(keyword._yearToNewPapers, year - 1) +
+                      valueIn(keyword._yearToNewPapers, year - 2);
+          }
+          EXPECT_DOUBLE_EQ(
+              store.impactFactorIn(row, range),
+              computeImpactFactor(sumIn(keyword._yearToIFCitations, from, to),
+                                  papers, 0));
+
+          // the z-score of the years of the range with citation data, at
+          // the reference year of the trends at most
+          Series series;
+          for (size_t year = std::max(from, citationFrom);
+               year <= std::min(to, citationTo); year++) {
+            series[year] = valueIn(keyword._yearToCitations, year);
+          }
+          EXPECT_NEAR(store.zScoreIn(row, range),
+                      computeZScore(series, std::min(to, refYear)), 1e-9)
+              << keyword._word << " " << from << "-" << to;
+        }
+      }
+      // all the years give the z-score of the whole series
+      EXPECT_NEAR(store.zScoreIn(row, YearRange{firstYear, lastYear}),
+                  store.zScore(row), 1e-9);
+    }
+  }
+}
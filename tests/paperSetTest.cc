@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "paperSet.hh"
+
+namespace {
+// Random ids over a few containers, dense enough in some of them to use
+// bitmaps (more than 4096 ids in a container)
+std::set<PaperSet::Id> randomIds(std::mt19937& rng) {
+  std::uniform_int_distribution<int> nContainers(1, 3);
+  std::uniform_int_distribution<int> density(0, 2);
+  std::set<PaperSet::Id> ids;
+  for (int c = nContainers(rng); c > 0; c--) {
+    PaperSet::Id key = std::uniform_int_distribution<PaperSet::Id>(0, 4)(rng);
+    const size_t sizes[] = {10, 3000, 9000};
+    size_t n = sizes[density(rng)];
+    std::uniform_int_distribution<PaperSet::Id> low(0, 0xFFFF);
+    for (size_t i = 0; i < n; i++) {
+      ids.insert(key << 16 | low(rng));
+    }
+  }
+  return ids;
+}
+
+PaperSet toPaperSet(const std::set<PaperSet::Id>& ids) {
+  return PaperSet::fromSorted(
+      std::vector<PaperSet::Id>(ids.begin(), ids.end()));
+}
+
+void expectEqual(const PaperSet& set, const std::set<PaperSet::Id>& ids) {
+  EXPECT_EQ(set.cardinality(), ids.size());
+  EXPECT_EQ(set.empty(), ids.empty());
+  EXPECT_EQ(set.toVector(),
+            std::vector<PaperSet::Id>(ids.begin(), ids.end()));
+}
+}  // namespace
+
+TEST(PaperSetTest, FromSortedAndAdd) {
+  std::mt19937 rng(1);
+  for (int i = 0; i < 20; i++) {
+    std::set<PaperSet::Id> ids = randomIds(rng);
+    expectEqual(toPaperSet(ids), ids);
+
+    // the same ids added one by one in random order, with repetitions
+    std::vector<PaperSet::Id> shuffled(ids.begin(), ids.end());
+    std::shuffle(shuffled.begin(), shuffled.end(), rng);
+    PaperSet added;
+    for (PaperSet::Id id : shuffled) {
+      added.add(id);
+    }
+    added.add(shuffled.front());
+    expectEqual(added, ids);
+
+    std::uniform_int_distribution<PaperSet::Id> anyId(0, 5 << 16);
+    for (int j = 0; j < 1000; j++) {
+      PaperSet::Id id = anyId(rng);
+      EXPECT_EQ(added.contains(id), ids.count(id) > 0);
+    }
+  }
+}
+
+TEST(PaperSetTest, SetOperations) {
+  std::mt19937 rng(2);
+  for (int i = 0; i < 50; i++) {
+    std::set<PaperSet::Id> a = randomIds(rng);
+    std::set<PaperSet::Id> b = randomIds(rng);
+    PaperSet setA = toPaperSet(a);
+    PaperSet setB = toPaperSet(b);
+
+    std::set<PaperSet::Id> expected;
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(),
+                   std::inserter(expected, expected.end()));
+    expectEqual(setA | setB, expected);
+    PaperSet united = setA;
+    united |= setB;
+    expectEqual(united, expected);
+
+    expected.clear();
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                          std::inserter(expected, expected.end()));
+    expectEqual(setA & setB, expected);
+
+    expected.clear();
+    std::set_difference(a.begin(), a.end(), b.begin(), b.end(),
+                        std::inserter(expected, expected.end()));
+    expectEqual(setA - setB, expected);
+  }
+}
+
+TEST(PaperSetTest, EmptySets) {
+  PaperSet empty;
+  PaperSet set = PaperSet::fromSorted({1, 2, 70000});
+  expectEqual(empty | empty, {});
+  expectEqual(set & empty, {});
+  expectEqual(set - set, {});
+  expectEqual(set - empty, {1, 2, 70000});
+  expectEqual(empty - set, {});
+}